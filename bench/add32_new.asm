@@ -0,0 +1,58 @@
+;; benchmark: S += X on 32-bit numbers, 65536 times, with ADC
+;; same result as add32_old.asm: D:C:B:A = 0x45:0x67:0x00:0x00, see bench/run.sh
+;; X at 0x8000, S at 0x8010, lowest byte first
+    LDI 0x67
+    STA 0x8000
+    LDI 0x45
+    STA 0x8001
+    LDI 0x23
+    STA 0x8002
+    LDI 0x01
+    STA 0x8003
+    LDI 0
+    STA 0x8010
+    STA 0x8011
+    STA 0x8012
+    STA 0x8013
+    MOV C, A            ; C:D counts the iterations
+    MOV D, A
+
+LOOP:
+    LDA 0x8000
+    MOV B, A
+    LDA 0x8010
+    ADD A, B
+    STA 0x8010
+    LDA 0x8001          ; LDA, MOV and STA leave the carry alone
+    MOV B, A
+    LDA 0x8011
+    ADC A, B
+    STA 0x8011
+    LDA 0x8002
+    MOV B, A
+    LDA 0x8012
+    ADC A, B
+    STA 0x8012
+    LDA 0x8003
+    MOV B, A
+    LDA 0x8013
+    ADC A, B
+    STA 0x8013
+
+    MOV A, D
+    INC
+    MOV D, A
+    JNZ LOOP
+    MOV A, C
+    INC
+    MOV C, A
+    JNZ LOOP
+
+    LDA 0x8013
+    MOV D, A
+    LDA 0x8012
+    MOV C, A
+    LDA 0x8011
+    MOV B, A
+    LDA 0x8010
+    HLT
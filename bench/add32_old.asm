@@ -0,0 +1,85 @@
+;; benchmark: S += X on 32-bit numbers, 65536 times, without ADC
+;; every byte add propagates its carry into the higher bytes with INC and branches
+;; same result as add32_new.asm: D:C:B:A = 0x45:0x67:0x00:0x00, see bench/run.sh
+    LDI 0x67
+    STA 0x8000
+    LDI 0x45
+    STA 0x8001
+    LDI 0x23
+    STA 0x8002
+    LDI 0x01
+    STA 0x8003
+    LDI 0
+    STA 0x8010
+    STA 0x8011
+    STA 0x8012
+    STA 0x8013
+    MOV C, A            ; C:D counts the iterations
+    MOV D, A
+
+LOOP:
+    LDA 0x8000
+    MOV B, A
+    LDA 0x8010
+    ADD A, B
+    STA 0x8010
+    JNC BYTE1
+    LDA 0x8011
+    INC
+    STA 0x8011
+    JNZ BYTE1
+    LDA 0x8012
+    INC
+    STA 0x8012
+    JNZ BYTE1
+    LDA 0x8013
+    INC
+    STA 0x8013
+BYTE1:
+    LDA 0x8001
+    MOV B, A
+    LDA 0x8011
+    ADD A, B
+    STA 0x8011
+    JNC BYTE2
+    LDA 0x8012
+    INC
+    STA 0x8012
+    JNZ BYTE2
+    LDA 0x8013
+    INC
+    STA 0x8013
+BYTE2:
+    LDA 0x8002
+    MOV B, A
+    LDA 0x8012
+    ADD A, B
+    STA 0x8012
+    JNC BYTE3
+    LDA 0x8013
+    INC
+    STA 0x8013
+BYTE3:
+    LDA 0x8003
+    MOV B, A
+    LDA 0x8013
+    ADD A, B
+    STA 0x8013
+
+    MOV A, D
+    INC
+    MOV D, A
+    JNZ LOOP
+    MOV A, C
+    INC
+    MOV C, A
+    JNZ LOOP
+
+    LDA 0x8013
+    MOV D, A
+    LDA 0x8012
+    MOV C, A
+    LDA 0x8011
+    MOV B, A
+    LDA 0x8010
+    HLT
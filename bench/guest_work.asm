@@ -0,0 +1,26 @@
+;; benchmark guest for --guests: touches 8 pages of its RAM in every loop iteration
+;; 4 x 256 iterations, about 17k instructions, see bench/guests.sh
+    LDI 4
+    MOV C, A
+OUTER:
+    LDI 0
+    MOV D, A
+INNER:
+    MOV A, D
+    STA 0x1000
+    STA 0x3100
+    STA 0x5200
+    STA 0x7300
+    LDA 0x9400
+    LDA 0xB500
+    LDA 0xD600
+    LDA 0xF700
+    MOV A, D
+    INC
+    MOV D, A
+    JNZ INNER
+    MOV A, C
+    DEC
+    MOV C, A
+    JNZ OUTER
+    HLT
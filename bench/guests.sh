@@ -0,0 +1,21 @@
+#!/bin/sh
+# Many resident guests with and without the instance arena (--arena): throughput,
+# TLB misses (perf_event_open, if the CPU/kernel allow it) and memory per guest.
+#
+# usage (from the project root directory, after make all):
+#   bench/guests.sh [guests, default 10000] [threads, default: online CPUs] [path/to/EmulatorRelease] [path/to/easm]
+
+GUESTS=${1:-10000}
+THREADS=${2:-$(getconf _NPROCESSORS_ONLN)}
+EMULATOR=${3:-build/Release/EmulatorRelease}
+EASM=${4:-build/easm}
+DIR=$(dirname "$0")
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+"$EASM" "$DIR/guest_work.asm" "$TMP/guest.bin" > /dev/null || exit 1
+
+for arena in "" --arena; do
+    echo "--- $GUESTS guests, $THREADS threads ${arena:-(ram_alloc)}"
+    "$EMULATOR" --guests "$GUESTS" --threads "$THREADS" $arena "$TMP/guest.bin" | grep -E '^(Guests|Memory|TLB):'
+done
@@ -0,0 +1,127 @@
+;; benchmark: S += M * N for N = 0 .. 4095, 16 x 16 -> 32-bit shift-and-add multiply
+;; with SHR/RCR to take the multiplier bits and SHL/RCL/ADC for the wide operands
+;; same result as mul16_old.asm: D:C:B:A = 0x71:0x88:0x88:0x00, see bench/run.sh
+;; M at 0x8000, N at 0x8002, P at 0x8010, S at 0x8050, lowest byte first
+    LDI 0xEF
+    STA 0x8000
+    LDI 0xBE
+    STA 0x8001
+    LDI 0
+    STA 0x8002
+    STA 0x8003
+    STA 0x8050
+    STA 0x8051
+    STA 0x8052
+    STA 0x8053
+
+LOOP:
+    CALL MUL16
+    LDA 0x8010          ; S += P
+    MOV B, A
+    LDA 0x8050
+    ADD A, B
+    STA 0x8050
+    LDA 0x8011
+    MOV B, A
+    LDA 0x8051
+    ADC A, B
+    STA 0x8051
+    LDA 0x8012
+    MOV B, A
+    LDA 0x8052
+    ADC A, B
+    STA 0x8052
+    LDA 0x8013
+    MOV B, A
+    LDA 0x8053
+    ADC A, B
+    STA 0x8053
+
+    LDA 0x8002          ; N++
+    INC
+    STA 0x8002
+    JNZ NEXT
+    LDA 0x8003
+    INC
+    STA 0x8003
+NEXT:
+    LDA 0x8003
+    MOV B, A
+    LDI 0x10
+    CMP A, B
+    JNE LOOP
+
+    LDA 0x8053
+    MOV D, A
+    LDA 0x8052
+    MOV C, A
+    LDA 0x8051
+    MOV B, A
+    LDA 0x8050
+    HLT
+
+;; P = M * N, the multiplicand MC (0x8020) shifts left, the multiplier (0x8030) right
+MUL16:
+    LDI 0
+    STA 0x8010
+    STA 0x8011
+    STA 0x8012
+    STA 0x8013
+    STA 0x8022
+    STA 0x8023
+    LDA 0x8000
+    STA 0x8020
+    LDA 0x8001
+    STA 0x8021
+    LDA 0x8002
+    STA 0x8030
+    LDA 0x8003
+    STA 0x8031
+    LDI 16
+    STA 0x8040
+MUL16_BIT:
+    LDA 0x8031          ; lowest multiplier bit into the carry
+    SHR A
+    STA 0x8031
+    LDA 0x8030
+    RCR A
+    STA 0x8030
+    JNC MUL16_SHIFT
+    LDA 0x8020          ; P += MC
+    MOV B, A
+    LDA 0x8010
+    ADD A, B
+    STA 0x8010
+    LDA 0x8021
+    MOV B, A
+    LDA 0x8011
+    ADC A, B
+    STA 0x8011
+    LDA 0x8022
+    MOV B, A
+    LDA 0x8012
+    ADC A, B
+    STA 0x8012
+    LDA 0x8023
+    MOV B, A
+    LDA 0x8013
+    ADC A, B
+    STA 0x8013
+MUL16_SHIFT:
+    LDA 0x8020          ; MC <<= 1
+    SHL A
+    STA 0x8020
+    LDA 0x8021
+    RCL A
+    STA 0x8021
+    LDA 0x8022
+    RCL A
+    STA 0x8022
+    LDA 0x8023
+    RCL A
+    STA 0x8023
+    LDA 0x8040
+    DEC
+    STA 0x8040
+    JNZ MUL16_BIT
+    RET
@@ -0,0 +1,191 @@
+;; benchmark: S += M * N for N = 0 .. 4095, 16 x 16 -> 32-bit shift-and-add multiply
+;; without shifts or ADC: shifting is ADD A, A, carries are propagated with branches
+;; same result as mul16_new.asm: D:C:B:A = 0x71:0x88:0x88:0x00, see bench/run.sh
+;; M at 0x8000, N at 0x8002, P at 0x8010, S at 0x8050, lowest byte first
+    LDI 0xEF
+    STA 0x8000
+    LDI 0xBE
+    STA 0x8001
+    LDI 0
+    STA 0x8002
+    STA 0x8003
+    STA 0x8050
+    STA 0x8051
+    STA 0x8052
+    STA 0x8053
+
+LOOP:
+    CALL MUL16
+    LDA 0x8010          ; S += P
+    MOV B, A
+    LDA 0x8050
+    ADD A, B
+    STA 0x8050
+    JNC SUM1
+    LDA 0x8051
+    INC
+    STA 0x8051
+    JNZ SUM1
+    LDA 0x8052
+    INC
+    STA 0x8052
+    JNZ SUM1
+    LDA 0x8053
+    INC
+    STA 0x8053
+SUM1:
+    LDA 0x8011
+    MOV B, A
+    LDA 0x8051
+    ADD A, B
+    STA 0x8051
+    JNC SUM2
+    LDA 0x8052
+    INC
+    STA 0x8052
+    JNZ SUM2
+    LDA 0x8053
+    INC
+    STA 0x8053
+SUM2:
+    LDA 0x8012
+    MOV B, A
+    LDA 0x8052
+    ADD A, B
+    STA 0x8052
+    JNC SUM3
+    LDA 0x8053
+    INC
+    STA 0x8053
+SUM3:
+    LDA 0x8013
+    MOV B, A
+    LDA 0x8053
+    ADD A, B
+    STA 0x8053
+
+    LDA 0x8002          ; N++
+    INC
+    STA 0x8002
+    JNZ NEXT
+    LDA 0x8003
+    INC
+    STA 0x8003
+NEXT:
+    LDA 0x8003
+    MOV B, A
+    LDI 0x10
+    CMP A, B
+    JNE LOOP
+
+    LDA 0x8053
+    MOV D, A
+    LDA 0x8052
+    MOV C, A
+    LDA 0x8051
+    MOV B, A
+    LDA 0x8050
+    HLT
+
+;; P = M * N, highest multiplier bit (0x8030) first: P <<= 1, P += M if the bit is set
+MUL16:
+    LDI 0
+    STA 0x8010
+    STA 0x8011
+    STA 0x8012
+    STA 0x8013
+    LDA 0x8002
+    STA 0x8030
+    LDA 0x8003
+    STA 0x8031
+    LDI 16
+    STA 0x8040
+MUL16_BIT:
+    LDA 0x8010          ; P <<= 1, INC puts the carry of the lower byte in
+    ADD A, A
+    STA 0x8010
+    JNC P1_NC
+    LDA 0x8011
+    ADD A, A
+    INC
+    STA 0x8011
+    JMP P1_DONE
+P1_NC:
+    LDA 0x8011
+    ADD A, A
+    STA 0x8011
+P1_DONE:
+    JNC P2_NC
+    LDA 0x8012
+    ADD A, A
+    INC
+    STA 0x8012
+    JMP P2_DONE
+P2_NC:
+    LDA 0x8012
+    ADD A, A
+    STA 0x8012
+P2_DONE:
+    JNC P3_NC
+    LDA 0x8013
+    ADD A, A
+    INC
+    STA 0x8013
+    JMP P3_DONE
+P3_NC:
+    LDA 0x8013
+    ADD A, A
+    STA 0x8013
+P3_DONE:
+    LDA 0x8030          ; highest multiplier bit into the carry
+    ADD A, A
+    STA 0x8030
+    JNC N1_NC
+    LDA 0x8031
+    ADD A, A
+    INC
+    STA 0x8031
+    JMP N1_DONE
+N1_NC:
+    LDA 0x8031
+    ADD A, A
+    STA 0x8031
+N1_DONE:
+    JNC MUL16_NEXT
+    LDA 0x8000          ; P += M
+    MOV B, A
+    LDA 0x8010
+    ADD A, B
+    STA 0x8010
+    JNC ADD1
+    LDA 0x8011
+    INC
+    STA 0x8011
+    JNZ ADD1
+    LDA 0x8012
+    INC
+    STA 0x8012
+    JNZ ADD1
+    LDA 0x8013
+    INC
+    STA 0x8013
+ADD1:
+    LDA 0x8001
+    MOV B, A
+    LDA 0x8011
+    ADD A, B
+    STA 0x8011
+    JNC MUL16_NEXT
+    LDA 0x8012
+    INC
+    STA 0x8012
+    JNZ MUL16_NEXT
+    LDA 0x8013
+    INC
+    STA 0x8013
+MUL16_NEXT:
+    LDA 0x8040
+    DEC
+    STA 0x8040
+    JNZ MUL16_BIT
+    RET
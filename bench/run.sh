@@ -0,0 +1,31 @@
+#!/bin/sh
+# 16/32-bit math benchmarks, each routine without (_old) and with (_new)
+# ADC/SBB/SHL/SHR/RCL/RCR. Both variants must end with the same registers.
+#
+# usage (from the project root directory, after make all):
+#   bench/run.sh [path/to/EmulatorRelease] [path/to/easm]
+
+EMULATOR=${1:-build/Release/EmulatorRelease}
+EASM=${2:-build/easm}
+DIR=$(dirname "$0")
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+now_ms() {
+    echo $(($(date +%s%N) / 1000000))
+}
+
+printf "%-8s %-4s %6s %12s %8s  %s\n" bench isa bytes cycles ms result
+for bench in add32 mul16; do
+    for variant in old new; do
+        "$EASM" "$DIR/${bench}_$variant.asm" "$TMP/$bench.bin" > /dev/null || exit 1
+        start=$(now_ms)
+        "$EMULATOR" "$TMP/$bench.bin" > "$TMP/out" || exit 1
+        end=$(now_ms)
+
+        bytes=$(wc -c < "$TMP/$bench.bin")
+        cycles=$(sed -n 's/^Cycles: //p' "$TMP/out")
+        result=$(grep '^A:' "$TMP/out")
+        printf "%-8s %-4s %6s %12s %8s  %s\n" "$bench" "$variant" "$bytes" "$cycles" $((end - start)) "$result"
+    done
+done
@@ -0,0 +1,18 @@
+;; daemon job: echoes its input back and counts the bytes in B
+;; run with: ./eclient /tmp/emu.sock daemon_echo.bin --input hello --jobs 100000 --pipeline 64
+LDI 0
+MOV B, A
+LOOP:
+IN 0                ; 0 once the input is used up
+MOV C, A
+LDI 0
+CMP C, A
+JE DONE
+MOV A, C
+OUT 0
+MOV A, B
+INC
+MOV B, A
+JMP LOOP
+DONE:
+HLT
@@ -0,0 +1,32 @@
+;; calls factorial(5) 200 times and sums the results (mod 256) in C
+;; pure subroutines like FACTORIAL are skipped when run with --memo
+JMP START_MAIN
+
+FACTORIAL:
+    CMP A, D
+    JE BASE_CASE
+    JL BASE_CASE     ; both jumps together are JLE
+    PUSH A           ; save current n
+    DEC A
+    CALL FACTORIAL   ; recursive call: factorial(n-1)
+    POP B            ; restore n into B
+    MUL A, B         ; A = A * n
+    RET
+BASE_CASE:
+    LDI 1
+    RET
+
+;; --- main program
+START_MAIN:
+    LDI 200
+    PUSH A           ; loop counter lives on the stack
+LOOP:
+    LDI 5
+    CALL FACTORIAL
+    ADD C, A
+    POP A
+    DEC
+    PUSH A
+    JNZ LOOP
+    POP A
+    HLT
@@ -0,0 +1,230 @@
+;; flag rules of ADC, SBB, SHL, SHR, RCL and RCR at their edge cases
+;; run with: ./EmulatorRelease flags.bin
+;; A = 0 if every check passed, otherwise the number of the first failing check
+;; (D = number of checks run). There is no jump on OF alone: JL is taken if SF != OF,
+;; with the sign known from the result that checks OF.
+
+;; 1: 0x7F + 0 + carry = 0x80: signed overflow, no carry
+    LDI 1
+    MOV D, A            ; check number
+    CALL SET_CARRY
+    LDI 0x00
+    MOV B, A
+    LDI 0x7F            ; LDI and MOV keep the carry
+    MOV C, A
+    ADC C, B
+    JC FAIL             ; CF = 0
+    JZ FAIL             ; ZF = 0
+    JL FAIL             ; SF = 1, OF = 1
+    LDI 0x80
+    CMP C, A
+    JNE FAIL
+
+;; 2: 0xFF + 0 + carry = 0x00: carry out, zero
+    LDI 2
+    MOV D, A            ; check number
+    CALL SET_CARRY
+    LDI 0x00
+    MOV B, A
+    LDI 0xFF            ; LDI and MOV keep the carry
+    MOV C, A
+    ADC C, B
+    JNC FAIL            ; CF = 1
+    JNZ FAIL            ; ZF = 1
+    JL FAIL             ; SF = 0, OF = 0
+    LDI 0x00
+    CMP C, A
+    JNE FAIL
+
+;; 3: 0x80 + 0x80 + 0 = 0x00: carry out and signed overflow
+    LDI 3
+    MOV D, A            ; check number
+    CALL CLEAR_CARRY
+    LDI 0x80
+    MOV B, A
+    LDI 0x80            ; LDI and MOV keep the carry
+    MOV C, A
+    ADC C, B
+    JNC FAIL            ; CF = 1
+    JNZ FAIL            ; ZF = 1
+    JL OK3              ; SF = 0, OF = 1
+    JMP FAIL
+OK3:
+    LDI 0x00
+    CMP C, A
+    JNE FAIL
+
+;; 4: 0x80 - 0 - borrow = 0x7F: signed overflow, no borrow
+    LDI 4
+    MOV D, A            ; check number
+    CALL SET_CARRY
+    LDI 0x00
+    MOV B, A
+    LDI 0x80            ; LDI and MOV keep the carry
+    MOV C, A
+    SBB C, B
+    JC FAIL             ; CF = 0
+    JZ FAIL             ; ZF = 0
+    JL OK4              ; SF = 0, OF = 1
+    JMP FAIL
+OK4:
+    LDI 0x7F
+    CMP C, A
+    JNE FAIL
+
+;; 5: 0x00 - 0 - borrow = 0xFF: borrow out
+    LDI 5
+    MOV D, A            ; check number
+    CALL SET_CARRY
+    LDI 0x00
+    MOV B, A
+    LDI 0x00            ; LDI and MOV keep the carry
+    MOV C, A
+    SBB C, B
+    JNC FAIL            ; CF = 1
+    JZ FAIL             ; ZF = 0
+    JL OK5              ; SF = 1, OF = 0
+    JMP FAIL
+OK5:
+    LDI 0xFF
+    CMP C, A
+    JNE FAIL
+
+;; 6: 0x05 - 0x05 - 0 = 0x00: zero, no borrow
+    LDI 6
+    MOV D, A            ; check number
+    CALL CLEAR_CARRY
+    LDI 0x05
+    MOV B, A
+    LDI 0x05            ; LDI and MOV keep the carry
+    MOV C, A
+    SBB C, B
+    JC FAIL             ; CF = 0
+    JNZ FAIL            ; ZF = 1
+    JL FAIL             ; SF = 0, OF = 0
+    LDI 0x00
+    CMP C, A
+    JNE FAIL
+
+;; 7: SHL 0x80 = 0x00: bit 7 to carry, sign changed
+    LDI 7
+    MOV D, A            ; check number
+    CALL CLEAR_CARRY
+    LDI 0x80            ; LDI and MOV keep the carry
+    MOV C, A
+    SHL C
+    JNC FAIL            ; CF = 1
+    JNZ FAIL            ; ZF = 1
+    JL OK7              ; SF = 0, OF = 1
+    JMP FAIL
+OK7:
+    LDI 0x00
+    CMP C, A
+    JNE FAIL
+
+;; 8: SHL 0x40 = 0x80: sign changed, no carry
+    LDI 8
+    MOV D, A            ; check number
+    CALL SET_CARRY
+    LDI 0x40            ; LDI and MOV keep the carry
+    MOV C, A
+    SHL C
+    JC FAIL             ; CF = 0
+    JZ FAIL             ; ZF = 0
+    JL FAIL             ; SF = 1, OF = 1
+    LDI 0x80
+    CMP C, A
+    JNE FAIL
+
+;; 9: SHR 0x81 = 0x40: bit 0 to carry, sign changed
+    LDI 9
+    MOV D, A            ; check number
+    CALL CLEAR_CARRY
+    LDI 0x81            ; LDI and MOV keep the carry
+    MOV C, A
+    SHR C
+    JNC FAIL            ; CF = 1
+    JZ FAIL             ; ZF = 0
+    JL OK9              ; SF = 0, OF = 1
+    JMP FAIL
+OK9:
+    LDI 0x40
+    CMP C, A
+    JNE FAIL
+
+;; 10: RCL 0x80 without carry = 0x00: bit 7 to carry
+    LDI 10
+    MOV D, A            ; check number
+    CALL CLEAR_CARRY
+    LDI 0x80            ; LDI and MOV keep the carry
+    MOV C, A
+    RCL C
+    JNC FAIL            ; CF = 1
+    JNZ FAIL            ; ZF = 1
+    JL OK10             ; SF = 0, OF = 1
+    JMP FAIL
+OK10:
+    LDI 0x00
+    CMP C, A
+    JNE FAIL
+
+;; 11: RCL 0x00 with carry = 0x01: carry comes in at bit 0
+    LDI 11
+    MOV D, A            ; check number
+    CALL SET_CARRY
+    LDI 0x00            ; LDI and MOV keep the carry
+    MOV C, A
+    RCL C
+    JC FAIL             ; CF = 0
+    JZ FAIL             ; ZF = 0
+    JL FAIL             ; SF = 0, OF = 0
+    LDI 0x01
+    CMP C, A
+    JNE FAIL
+
+;; 12: RCR 0x01 without carry = 0x00: bit 0 to carry
+    LDI 12
+    MOV D, A            ; check number
+    CALL CLEAR_CARRY
+    LDI 0x01            ; LDI and MOV keep the carry
+    MOV C, A
+    RCR C
+    JNC FAIL            ; CF = 1
+    JNZ FAIL            ; ZF = 1
+    JL FAIL             ; SF = 0, OF = 0
+    LDI 0x00
+    CMP C, A
+    JNE FAIL
+
+;; 13: RCR 0x00 with carry = 0x80: carry comes in at bit 7
+    LDI 13
+    MOV D, A            ; check number
+    CALL SET_CARRY
+    LDI 0x00            ; LDI and MOV keep the carry
+    MOV C, A
+    RCR C
+    JC FAIL             ; CF = 0
+    JZ FAIL             ; ZF = 0
+    JL FAIL             ; SF = 1, OF = 1
+    LDI 0x80
+    CMP C, A
+    JNE FAIL
+
+    LDI 0
+    HLT
+
+FAIL:
+    MOV A, D
+    HLT
+
+SET_CARRY:              ; CF = 1, A = 0, B = 0xFF
+    LDI 0xFF
+    MOV B, A
+    LDI 1
+    ADD A, B
+    RET
+
+CLEAR_CARRY:            ; CF = 0, A = 0
+    LDI 0
+    ADD A, A
+    RET
@@ -0,0 +1,22 @@
+;; fuzz target: jumps into garbage when the input at 0x8000 starts with "BUG"
+;; run with: ./EmulatorRelease --fuzz 0x8000:8 --fuzz-out crashes fuzz_target.bin
+LDI 66              ; 'B'
+MOV B, A
+LDA 0x8000
+CMP A, B
+JNE DONE
+LDI 85              ; 'U'
+MOV B, A
+LDA 0x8001
+CMP A, B
+JNE DONE
+LDI 71              ; 'G'
+MOV B, A
+LDA 0x8002
+CMP A, B
+JNE DONE
+LDI 238             ; 0xEE is no instruction
+STA 0x9000
+JMP 0x9000
+DONE:
+HLT
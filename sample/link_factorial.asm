@@ -0,0 +1,17 @@
+;; factorial(A) -> A, see link_main.asm
+GLOBAL FACTORIAL
+FACTORIAL:
+    CMP A, D
+    JE BASE_CASE
+    JL BASE_CASE
+    PUSH A
+    DEC
+    CALL FACTORIAL
+    POP B
+    MUL A, B
+    RET
+BASE_CASE:
+    LDI 1
+    RET
+LOOP:
+    RET
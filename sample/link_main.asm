@@ -0,0 +1,12 @@
+;; two-file program, build with:
+;;   ./ebuild -o link.bin --map link.map link_main.asm link_factorial.asm
+;; or by hand:
+;;   ./easm -c link_main.asm link_main.o && ./easm -c link_factorial.asm link_factorial.o
+;;   ./eld -o link.bin --map link.map link_main.o link_factorial.o
+GLOBAL MAIN
+MAIN:
+    LDI 5
+    CALL FACTORIAL      ; defined in link_factorial.asm
+    MOV C, A            ; C = 120
+LOOP:                   ; local label, link_factorial.asm has its own
+    HLT
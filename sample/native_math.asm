@@ -0,0 +1,106 @@
+;; software multiply and divide, every combination of two bytes
+;; run natively with:
+;;   ./easm --map native_math.map native_math.asm native_math.bin
+;;   ./EmulatorRelease --symbols native_math.map --native mul8@MUL8 --native div8@DIV8 native_math.bin
+;; add --native-verify to check the guest routines against the natives
+;; A = sum of all product bytes, B = sum of all quotients and remainders (mod 256)
+    LDI 0
+    STA 0x7F10          ; a
+    STA 0x7F11          ; b
+    STA 0x7F20          ; sums
+    STA 0x7F21
+LOOP:
+    LDA 0x7F11
+    MOV B, A
+    LDA 0x7F10
+    CALL MUL8
+    ADD A, B
+    MOV B, A
+    LDA 0x7F20
+    ADD A, B
+    STA 0x7F20
+
+    LDA 0x7F11
+    MOV B, A
+    LDA 0x7F10
+    CALL DIV8
+    ADD A, B
+    MOV B, A
+    LDA 0x7F21
+    ADD A, B
+    STA 0x7F21
+
+    LDA 0x7F11          ; b++
+    INC
+    STA 0x7F11
+    JNZ LOOP
+    LDA 0x7F10          ; a++
+    INC
+    STA 0x7F10
+    JNZ LOOP
+
+    LDA 0x7F21
+    MOV B, A
+    LDA 0x7F20
+    HLT
+
+;; B:A = A * B, shift-and-add, highest multiplier bit first. C and D are preserved
+MUL8:
+    PUSH C
+    PUSH D
+    MOV C, A            ; multiplicand
+    LDI 8
+    STA 0x7F00          ; bits left
+    LDI 0
+    MOV D, A            ; product is A:D
+MUL8_BIT:
+    SHL D               ; product <<= 1
+    RCL A
+    SHL B               ; next multiplier bit
+    JNC MUL8_NEXT
+    ADD D, C            ; product += multiplicand
+    JNC MUL8_NEXT
+    INC
+MUL8_NEXT:
+    PUSH A
+    LDA 0x7F00
+    DEC
+    STA 0x7F00
+    POP A               ; POP leaves the flags alone
+    JNZ MUL8_BIT
+    MOV B, A
+    MOV A, D
+    POP D
+    POP C
+    RET
+
+;; A = A / B, B = A % B, restoring division. A / 0 gives 0xFF remainder A. C and D are preserved
+DIV8:
+    PUSH C
+    PUSH D
+    MOV C, A            ; dividend, shifted out while the quotient is shifted in
+    LDI 8
+    STA 0x7F00          ; bits left
+    LDI 0
+    MOV D, A            ; remainder
+DIV8_BIT:
+    SHL C
+    RCL D
+    JC DIV8_SUB         ; the remainder has 9 bits, bigger than any divisor
+    CMP D, B
+    JC DIV8_NEXT
+DIV8_SUB:
+    SUB D, B
+    MOV A, C
+    INC
+    MOV C, A
+DIV8_NEXT:
+    LDA 0x7F00
+    DEC
+    STA 0x7F00
+    JNZ DIV8_BIT
+    MOV A, C
+    MOV B, D
+    POP D
+    POP C
+    RET
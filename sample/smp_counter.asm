@@ -0,0 +1,37 @@
+;; every CPU adds 50 to a shared counter at 0x8001,
+;; the counter is guarded by a TAS spinlock at 0x8000,
+;; the increment is a subroutine, so every core uses its own stack
+;; run with: ./EmulatorRelease --smp 4 smp_counter.bin
+LDI 50
+MOV C, A            ; C = iterations left
+
+LOOP:
+ACQUIRE:
+    TAS 0x8000      ; A = old lock value, ZF set if we got the lock
+    JNZ ACQUIRE
+    CALL BUMP
+    LDI 0
+    STA 0x8000      ; release the lock
+    MOV A, C
+    DEC
+    MOV C, A
+    JNZ LOOP
+
+CPUID
+MOV B, A            ; B = core number
+FINAL:
+    TAS 0x8000      ; read the counter under the lock as well
+    JNZ FINAL
+    LDA 0x8001
+    MOV C, A
+    LDI 0
+    STA 0x8000
+    MOV A, C        ; A = counter as seen by this CPU
+HLT
+
+;; counter + 1, with the lock held
+BUMP:
+    LDA 0x8001
+    INC
+    STA 0x8001
+    RET
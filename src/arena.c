@@ -0,0 +1,144 @@
+#include "arena.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+static size_t round_up(size_t value, size_t to) {
+    return (value + to - 1) / to * to;
+}
+
+// huge pages from the reserved pool if there are any, transparent huge pages otherwise
+static uint8_t* map_slab(size_t bytes, bool* hugetlb) {
+    void* memory = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED) {
+        *hugetlb = true;
+        return memory;
+    }
+    *hugetlb = false;
+
+    // over-allocate to align the slab to a huge page, THP only backs aligned 2 MiB ranges
+    size_t padded = bytes + ARENA_HUGE_PAGE;
+    uint8_t* raw = mmap(NULL, padded, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+
+    uint8_t* aligned = (uint8_t*)round_up((uintptr_t)raw, ARENA_HUGE_PAGE);
+    if (aligned > raw) munmap(raw, (size_t)(aligned - raw));
+    size_t tail = (size_t)(raw + padded - (aligned + bytes));
+    if (tail) munmap(aligned + bytes, tail);
+
+    madvise(aligned, bytes, MADV_HUGEPAGE);
+    return aligned;
+}
+
+// a couple of bulk copies, a fresh guest never had its own state
+static void reset_guest(Arena* arena, Guest* guest) {
+    RAM* ram = guest->ram;
+    uint32_t index = guest->index;
+
+    *guest = arena->fresh;
+    guest->ram = ram;
+    guest->index = index;
+
+    memcpy(ram->memory, arena->image->memory, arena->program_size);
+    memset(ram->memory + arena->program_size, 0, RAM_SIZE - arena->program_size);
+}
+
+typedef struct {
+    Arena* arena;
+    size_t worker;
+    size_t first;           // index of the slab's first guest
+} SlabInit;
+
+// runs on the CPU of the slab's worker, so the first touch places the pages there
+static void* init_slab(void* arg) {
+    SlabInit* init = arg;
+    Arena* arena = init->arena;
+    ArenaSlab* slab = &arena->slabs[init->worker];
+
+    if (!sched_pin_thread(init->worker)) {
+        fprintf(stderr, "Warning: Could not pin the first touch of slab %zu, its pages may land on "
+            "a remote node\n", init->worker);
+    }
+    for (size_t i = 0; i < slab->count; i++) {
+        Guest* guest = &slab->guests[i];
+        guest->ram = &slab->rams[i];
+        guest->index = (uint32_t)(init->first + i);
+        reset_guest(arena, guest);
+    }
+    return NULL;
+}
+
+bool arena_init(Arena* arena, size_t workers, size_t count, const RAM* image, size_t program_size) {
+    memset(arena, 0, sizeof(Arena));
+    arena->workers = workers ? workers : 1;
+    arena->count = count;
+    arena->image = image;
+    arena->program_size = program_size < RAM_SIZE ? program_size : RAM_SIZE;
+    cpu_reset(&arena->fresh.cpu);
+
+    arena->slabs = calloc(arena->workers, sizeof(ArenaSlab));
+    SlabInit* inits = calloc(arena->workers, sizeof(SlabInit));
+    pthread_t* threads = calloc(arena->workers, sizeof(pthread_t));
+    if (!arena->slabs || !inits || !threads) {
+        free(inits);
+        free(threads);
+        arena_free(arena);
+        return false;
+    }
+
+    // map every slab first, the per worker initialization then runs in parallel
+    bool hugetlb = true;
+    size_t first = 0;
+    for (size_t w = 0; w < arena->workers; w++) {
+        ArenaSlab* slab = &arena->slabs[w];
+        slab->count = count / arena->workers + (w < count % arena->workers);
+
+        size_t rams = slab->count * sizeof(RAM);
+        slab->bytes = round_up(rams + slab->count * sizeof(Guest), ARENA_HUGE_PAGE);
+
+        bool slab_hugetlb;
+        slab->base = map_slab(slab->bytes, &slab_hugetlb);
+        if (!slab->base) {
+            free(inits);
+            free(threads);
+            arena_free(arena);
+            return false;
+        }
+        hugetlb &= slab_hugetlb;
+        slab->rams = (RAM*)slab->base;
+        slab->guests = (Guest*)(slab->base + rams);
+
+        inits[w] = (SlabInit){arena, w, first};
+        first += slab->count;
+    }
+    arena->hugetlb = hugetlb;
+
+    for (size_t w = 0; w < arena->workers; w++) {
+        if (pthread_create(&threads[w], NULL, init_slab, &inits[w]) != 0) {
+            fprintf(stderr, "Error: Could not start arena thread %zu\n", w);
+            exit(1);
+        }
+    }
+    for (size_t w = 0; w < arena->workers; w++) {
+        pthread_join(threads[w], NULL);
+    }
+
+    free(inits);
+    free(threads);
+    return true;
+}
+
+void arena_free(Arena* arena) {
+    if (arena->slabs) {
+        for (size_t w = 0; w < arena->workers; w++) {
+            if (arena->slabs[w].base) munmap(arena->slabs[w].base, arena->slabs[w].bytes);
+        }
+    }
+    free(arena->slabs);
+    arena->slabs = NULL;
+}
@@ -0,0 +1,47 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "cpu.h"
+#include "ram.h"
+#include "sched.h"
+
+// Instance arena for many guests: the Guest contexts and guest RAMs of every scheduler
+// worker come from one slab instead of scattered allocations.
+//
+// A slab is a single mapping, MAP_HUGETLB if the system has huge pages reserved, else
+// regular memory with MADV_HUGEPAGE so transparent huge pages back it: 32 guest RAMs
+// share one 2 MiB TLB entry instead of one 4 KiB entry per page they touch. Every slab
+// is first touched by a thread pinned to the CPU its worker will be pinned to
+// (Scheduler.pin), so the default NUMA policy puts its pages on that worker's node.
+//
+// The price: a huge page is resident as a whole, every guest costs its full 64 KiB.
+
+#define ARENA_HUGE_PAGE     (2 * 1024 * 1024)
+
+typedef struct {
+    uint8_t* base;
+    size_t bytes;
+    size_t count;           // guests in this slab
+    RAM* rams;              // at the start, huge page aligned
+    Guest* guests;          // after the RAMs
+} ArenaSlab;
+
+typedef struct {
+    ArenaSlab* slabs;       // one per worker
+    size_t workers;
+    size_t count;
+    bool hugetlb;           // MAP_HUGETLB worked, else transparent huge pages
+
+    Guest fresh;            // a reset guest, copied over every new one
+    const RAM* image;
+    size_t program_size;
+} Arena;
+
+// allocates and initializes `count` guests running `image`, spread over `workers` slabs
+bool arena_init(Arena* arena, size_t workers, size_t count, const RAM* image, size_t program_size);
+void arena_free(Arena* arena);
+
+#endif //ARENA_H
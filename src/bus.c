@@ -1 +1,30 @@
-#include "bus.h"
\ No newline at end of file
+#include "bus.h"
+
+#include <string.h>
+
+void bus_init(Bus* bus, RAM* ram) {
+    bus->ram = ram;
+    memset(bus->pages, 0, sizeof(bus->pages));
+    bus->trap = NULL;
+    bus->ctx = NULL;
+}
+
+void bus_set_trap(Bus* bus, BusTrap trap, void* ctx) {
+    bus->trap = trap;
+    bus->ctx = ctx;
+}
+
+// atomics count as writes
+uint8_t bus_test_and_set(Bus* bus, uint16_t address) {
+    if (bus->pages[address >> BUS_PAGE_SHIFT] & (BUS_TRAP_READ | BUS_TRAP_WRITE)) {
+        bus->trap(bus->ctx, address, 1, true);
+    }
+    return ram_test_and_set(bus->ram, address);
+}
+
+bool bus_compare_exchange(Bus* bus, uint16_t address, uint8_t* expected, uint8_t desired) {
+    if (bus->pages[address >> BUS_PAGE_SHIFT] & (BUS_TRAP_READ | BUS_TRAP_WRITE)) {
+        bus->trap(bus->ctx, address, desired, true);
+    }
+    return ram_compare_exchange(bus->ram, address, expected, desired);
+}
@@ -2,8 +2,53 @@
 #define BUS_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include "ram.h"
 
-uint8_t bus_read(uint16_t address);
-void bus_write(uint16_t address, uint8_t value);
+// The bus sits between a CPU and its RAM for everything that needs to see memory
+// accesses. RAM is split into pages, every page has a set of trap flags. Accesses
+// to pages without flags go straight to RAM, the others call the trap first.
+
+#define BUS_PAGE_SHIFT  8
+#define BUS_PAGE_SIZE   (1 << BUS_PAGE_SHIFT)
+#define BUS_PAGES       (RAM_SIZE / BUS_PAGE_SIZE)
+
+#define BUS_TRAP_READ   0x01
+#define BUS_TRAP_WRITE  0x02
+
+// called before the access, value is the byte about to be written (0 on reads)
+typedef void (*BusTrap)(void* ctx, uint16_t address, uint8_t value, bool write);
+
+typedef struct {
+    RAM* ram;
+    uint8_t pages[BUS_PAGES];   // trap flags per page
+    BusTrap trap;
+    void* ctx;
+} Bus;
+
+void bus_init(Bus* bus, RAM* ram);
+void bus_set_trap(Bus* bus, BusTrap trap, void* ctx);
+
+static inline uint8_t bus_read(Bus* bus, uint16_t address) {
+    if (bus->pages[address >> BUS_PAGE_SHIFT] & BUS_TRAP_READ) {
+        bus->trap(bus->ctx, address, 0, false);
+    }
+    return bus->ram->memory[address];
+}
+
+// opcode and operand bytes, never trapped: watchpoints and dirty tracking are about data
+static inline uint8_t bus_fetch(Bus* bus, uint16_t address) {
+    return bus->ram->memory[address];
+}
+
+static inline void bus_write(Bus* bus, uint16_t address, uint8_t value) {
+    if (bus->pages[address >> BUS_PAGE_SHIFT] & BUS_TRAP_WRITE) {
+        bus->trap(bus->ctx, address, value, true);
+    }
+    bus->ram->memory[address] = value;
+}
+
+uint8_t bus_test_and_set(Bus* bus, uint16_t address);
+bool bus_compare_exchange(Bus* bus, uint16_t address, uint8_t* expected, uint8_t desired);
 
 #endif //BUS_H
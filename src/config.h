@@ -0,0 +1,37 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// Build-time configuration shared by the emulator and the tools.
+// Override with -DCPU_NUM_REGISTERS=<n> (cmake: -DCPU_NUM_REGISTERS=<n>, make: REGISTERS=<n>)
+
+// number of general purpose registers
+// A, B, C and D are always present, every register above D is named R4, R5, ...
+#ifndef CPU_NUM_REGISTERS
+#define CPU_NUM_REGISTERS 4
+#endif
+
+#if CPU_NUM_REGISTERS < 4 || CPU_NUM_REGISTERS > 256
+#error "CPU_NUM_REGISTERS must be between 4 and 256"
+#endif
+
+// the register file is rounded up to a power of two so a register operand
+// can be masked instead of bounds checked on every instruction
+#if CPU_NUM_REGISTERS <= 4
+#define CPU_REGISTER_SLOTS 4
+#elif CPU_NUM_REGISTERS <= 8
+#define CPU_REGISTER_SLOTS 8
+#elif CPU_NUM_REGISTERS <= 16
+#define CPU_REGISTER_SLOTS 16
+#elif CPU_NUM_REGISTERS <= 32
+#define CPU_REGISTER_SLOTS 32
+#elif CPU_NUM_REGISTERS <= 64
+#define CPU_REGISTER_SLOTS 64
+#elif CPU_NUM_REGISTERS <= 128
+#define CPU_REGISTER_SLOTS 128
+#else
+#define CPU_REGISTER_SLOTS 256
+#endif
+
+#define CPU_REGISTER_MASK (CPU_REGISTER_SLOTS - 1)
+
+#endif //CONFIG_H
@@ -3,6 +3,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "native.h"
+
 // FLAG LOGIC
 void set_flag(uint8_t* flags, uint8_t mask) {
     *flags |= mask;
@@ -38,6 +40,14 @@ void set_flags_sub(CPU* cpu, uint8_t reg1, uint8_t reg2, uint16_t result) {
     SET_FLAG_IF(cpu, ((reg1 ^ reg2) & (reg1 ^ result)) & 0x80, FLAG_OVERFLOW);
 }
 
+// like set_flags_sub, the borrow counts towards CF (ADC reuses set_flags_add as is)
+void set_flags_sbb(CPU* cpu, uint8_t reg1, uint8_t reg2, uint8_t borrow, uint16_t result) {
+    SET_FLAG_IF(cpu, (uint8_t)result == 0, FLAG_ZERO);
+    SET_FLAG_IF(cpu, (uint16_t)reg1 < (uint16_t)reg2 + borrow, FLAG_CARRY);
+    SET_FLAG_IF(cpu, (result & 0x80), FLAG_SIGN);
+    SET_FLAG_IF(cpu, ((reg1 ^ reg2) & (reg1 ^ result)) & 0x80, FLAG_OVERFLOW);
+}
+
 void set_flags_inc(CPU* cpu, uint8_t original, uint16_t result) {
     SET_FLAG_IF(cpu, (uint8_t)result == 0, FLAG_ZERO);
     SET_FLAG_IF(cpu, (result & 0x80), FLAG_SIGN);
@@ -72,31 +82,98 @@ void set_flags_mul(CPU* cpu, uint16_t result) {
     SET_FLAG_IF(cpu, overflow, FLAG_OVERFLOW);
 }
 
+// CF is the bit shifted out, OF is set if the sign changed
+void set_flags_shift(CPU* cpu, uint8_t original, uint8_t result, bool carry) {
+    SET_FLAG_IF(cpu, result == 0, FLAG_ZERO);
+    SET_FLAG_IF(cpu, (result & 0x80), FLAG_SIGN);
+    SET_FLAG_IF(cpu, carry, FLAG_CARRY);
+    SET_FLAG_IF(cpu, (original ^ result) & 0x80, FLAG_OVERFLOW);
+}
+
 // REGISTER BOUNDS CHECK
 bool register_out_of_bounds(CPU* cpu, uint8_t registers) {
-    size_t array_elems = sizeof(cpu->registers) / sizeof(cpu->registers[0]);
+    (void)cpu;
+    return registers >= CPU_NUM_REGISTERS;
+}
 
-    if (registers >= array_elems) {
-        return true;
+// PROGRAM VALIDATION
+static bool is_jump(uint8_t opcode) {
+    return opcode == CALL || (opcode >= JMP && opcode <= JA) || opcode == JLE || opcode == JGE;
+}
+
+// instructions after which execution does not fall through
+static bool ends_flow(uint8_t opcode) {
+    return opcode == JMP || opcode == RET || opcode == HLT || opcode == HCALL;
+}
+
+// follows the code reachable from `start` through fall-through and direct jumps,
+// checking every register operand once so cpu_step does not have to. Data after the
+// code is never decoded; code reached only by computed returns or self-modification
+// is not checked, the interpreter masks its operands (see REG)
+bool cpu_validate_program(RAM* ram, uint16_t start, size_t size, uint16_t* bad_address) {
+    uint8_t seen[RAM_SIZE / 8] = {0};       // instruction starts already checked
+    uint8_t queued[RAM_SIZE / 8] = {0};     // jump targets still to follow
+    size_t end = (size_t)start + size;
+    if (end > RAM_SIZE) end = RAM_SIZE;
+    if (!size) return true;
+
+    queued[start >> 3] |= (uint8_t)(1 << (start & 7));
+    bool pending = true;
+
+    while (pending) {
+        pending = false;
+        for (size_t target = start; target < end; target++) {
+            if (!(queued[target >> 3] & (1 << (target & 7)))) continue;
+            queued[target >> 3] &= (uint8_t)~(1 << (target & 7));
+
+            size_t addr = target;
+            while (addr < end && !(seen[addr >> 3] & (1 << (addr & 7)))) {
+                seen[addr >> 3] |= (uint8_t)(1 << (addr & 7));
+
+                uint8_t opcode = ram_read(ram, (uint16_t)addr);
+                const OpcodeInfo* info = &cpu_opcodes[opcode];
+                // unknown opcodes halt the CPU, nothing follows
+                if (!info->length) break;
+
+                uint8_t count = info->operands == OPERANDS_REG_REG ? 2 : info->operands == OPERANDS_REG ? 1 : 0;
+                for (uint8_t i = 0; i < count && addr + 1 + i < end; i++) {
+                    if (ram_read(ram, (uint16_t)(addr + 1 + i)) >= CPU_NUM_REGISTERS) {
+                        if (bad_address) *bad_address = (uint16_t)addr;
+                        return false;
+                    }
+                }
+
+                if (is_jump(opcode) && addr + 2 < end) {
+                    uint16_t to = (uint16_t)(ram_read(ram, (uint16_t)(addr + 1)) << 8 | ram_read(ram, (uint16_t)(addr + 2)));
+                    if (to >= start && to < end && !(seen[to >> 3] & (1 << (to & 7)))) {
+                        queued[to >> 3] |= (uint8_t)(1 << (to & 7));
+                        pending = true;
+                    }
+                }
+                if (ends_flow(opcode)) break;
+                addr += info->length;
+            }
+        }
     }
 
-    return false;
+    return true;
 }
 
 // MISC
 size_t get_number_of_registers(CPU* cpu) {
-    const size_t reg_num = sizeof(cpu->registers) / sizeof(cpu->registers[0]);
-    return reg_num;
+    (void)cpu;
+    return CPU_NUM_REGISTERS;
 }
 
 // DEBUG
 void print_state(CPU* cpu) {
     // registers
-    printf("A:%d B:%d C:%d D:%d\n",
-        cpu->registers[0],
-        cpu->registers[1],
-        cpu->registers[2],
-        cpu->registers[3]);
+    static const char names[] = "ABCD";
+    for (size_t i = 0; i < CPU_NUM_REGISTERS; i++) {
+        if (i < 4) printf("%s%c:%d", i ? " " : "", names[i], cpu->registers[i]);
+        else printf(" R%zu:%d", i, cpu->registers[i]);
+    }
+    printf("\n");
 
     // program counter
     printf("PC: d:%d h:0x%08x\n",
@@ -106,6 +183,8 @@ void print_state(CPU* cpu) {
     printf("SP: d:%d h:0x%08x\n",
         cpu->SP, cpu->SP);
 
+    printf("Cycles: %llu\n", (unsigned long long)cpu->cycles);
+
     print_flags(cpu->FLAGS);
 }
 
@@ -117,425 +196,110 @@ void print_flags(uint8_t flags) {
         !!(flags & FLAG_OVERFLOW));
 }
 
+// DECODING AND TIMING
+const OpcodeInfo cpu_opcodes[256] = {
+#define ISA(name, opcode, operands, cycles, assembler) [opcode] = ISA_INFO(name, operands, cycles, assembler),
+#include "isa.def"
+#undef ISA
+};
+
+const uint8_t cpu_cycle_costs[256] = {
+#define ISA(name, opcode, operands, cycles, assembler) [opcode] = cycles,
+#include "isa.def"
+#undef ISA
+};
+
 //CPU
 void cpu_reset(CPU *cpu) {
-    for (size_t i = 0; i < get_number_of_registers(cpu); i++) {
+    for (size_t i = 0; i < CPU_REGISTER_SLOTS; i++) {
         cpu->registers[i] = 0;
     }
     cpu->PC = 0x0000;
     cpu->SP = RAM_SIZE - 1;     // 0x100 -> but stack grows downwards
     cpu->FLAGS = 0;
     cpu->halted = false;
+    cpu->stop = STOP_NONE;
+    cpu->id = 0;
+    cpu->io = NULL;
+    cpu->cycles = 0;
 }
 
-void cpu_step(CPU* cpu, RAM* ram) {
-    if (cpu->halted) return;
-
-    uint8_t opcode = ram_read(ram, cpu->PC++);
-
-    switch (opcode) {
-        case NOP:
-            break;
-
-        case LDA: {
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-            cpu->registers[A] = ram_read(ram, addr);
-
-            if (cpu->registers[A] == 0) set_flag(&cpu->FLAGS, FLAG_ZERO);
-            else clear_flag(&cpu->FLAGS, FLAG_ZERO);
-            break;
-        }
-
-        case LDB: {
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-            cpu->registers[B] = ram_read(ram, addr);
-            break;
-        }
-
-        case LDI: {
-            uint8_t immediate_value = ram_read(ram, cpu->PC++);
-            cpu->registers[A] = immediate_value;
-
-            if (cpu->registers[A] == 0) set_flag(&cpu->FLAGS, FLAG_ZERO);
-            else clear_flag(&cpu->FLAGS, FLAG_ZERO);
-            break;
-        }
-
-        case INC: {      // not updating the carry flag on purpose
-            uint16_t result = cpu->registers[A] + 1;
-            uint8_t original = cpu->registers[A];
-
-            set_flags_inc(cpu, original, result);
-            cpu->registers[A] = result;
-            break;
-        }
-
-        case DEC: {      // not updating the carry flag on purpose
-            uint16_t result = cpu->registers[A] - 1;
-            uint8_t original = cpu->registers[A];
-
-            set_flags_dec(cpu, original, result);
-            cpu->registers[A] = result;
-            break;
-        }
-
-        case ADD: {     // ADD C, B
-            uint8_t reg_to = ram_read(ram, cpu->PC++);
-            uint8_t reg_from = ram_read(ram, cpu->PC++);
-
-            if (register_out_of_bounds(cpu, reg_to)) exit(1);
-            if (register_out_of_bounds(cpu, reg_from)) exit(1);
-
-            uint16_t a = (uint16_t)cpu->registers[reg_to];
-            uint16_t b = (uint16_t)cpu->registers[reg_from];
-            uint16_t result = a + b;
-
-            set_flags_add(cpu, a, b, result);
-            cpu->registers[reg_to] = (uint8_t)result;
-            break;
-        }
-
-        case SUB: {     // SUB C, B
-            uint8_t reg_to = ram_read(ram, cpu->PC++);
-            uint8_t reg_from = ram_read(ram, cpu->PC++);
-
-            if (register_out_of_bounds(cpu, reg_to)) exit(1);
-            if (register_out_of_bounds(cpu, reg_from)) exit(1);
-
-            uint16_t a = (uint16_t)cpu->registers[reg_to];
-            uint16_t b = (uint16_t)cpu->registers[reg_from];
-            uint16_t result = a - b;
-
-            set_flags_sub(cpu, a, b, result);
-            cpu->registers[reg_to] = (uint8_t)result;
-            break;
-        }
-
-        case MUL: {     // MUL D, B
-            uint8_t reg_to = ram_read(ram, cpu->PC++);
-            uint8_t reg_from = ram_read(ram, cpu->PC++);
-
-            if (register_out_of_bounds(cpu, reg_to)) exit(1);
-            if (register_out_of_bounds(cpu, reg_from)) exit(1);
-
-            uint16_t a = (uint16_t)cpu->registers[reg_to];
-            uint16_t b = (uint16_t)cpu->registers[reg_from];
-            uint16_t result = a * b;
-
-            set_flags_mul(cpu, result);
-            cpu->registers[reg_to] = (uint8_t) (result & 0xFF); // store low
-            break;
-        }
-
-        case STA: {
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-            ram_write(ram, addr, cpu->registers[A]);
-            break;
-        }
-
-        case STB: {
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-            ram_write(ram, addr, cpu->registers[B]);
-            break;
-        }
-
-        case MOV: {     // move B register into A: MOV A, B
-            uint8_t reg_to = ram_read(ram, cpu->PC++);
-            uint8_t reg_from = ram_read(ram, cpu->PC++);
-
-            if (register_out_of_bounds(cpu, reg_to)) exit(1);
-            if (register_out_of_bounds(cpu, reg_from)) exit(1);
-
-            cpu->registers[reg_to] = cpu->registers[reg_from];
-
-            break;
-        }
-
-        case CMP: {     // CMP B, D
-            uint8_t reg_to = ram_read(ram, cpu->PC++);
-            uint8_t reg_from = ram_read(ram, cpu->PC++);
-
-            if (register_out_of_bounds(cpu, reg_to)) exit(1);
-            if (register_out_of_bounds(cpu, reg_from)) exit(1);
-
-            uint16_t a = (uint16_t)cpu->registers[reg_to];
-            uint16_t b = (uint16_t)cpu->registers[reg_from];
-            uint16_t result = a - b;
-
-            set_flags_sub(cpu, a, b, result);
-            break;
-        }
-
-        case JMP: {     // unconditional jump
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-            cpu->PC = addr;
-            break;
-        }
-
-        case JZ: {      // jump if zero
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-
-            bool zf = is_flag_set(cpu->FLAGS, FLAG_ZERO);
-            if (zf) {
-                cpu->PC = addr;
-            }
-            break;
-        }
-
-        case JNZ: {     // jump if not zero
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-
-            bool zf = is_flag_set(cpu->FLAGS, FLAG_ZERO);
-            if (!zf) {
-                cpu->PC = addr;
-            }
-            break;
-        }
-
-        case JC: {      // jump if carry flag is set
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-
-            bool cf = is_flag_set(cpu->FLAGS, FLAG_CARRY);
-
-            if (cf) {
-                cpu->PC = addr;
-            }
-            break;
-        }
+uint64_t cpu_run(CPU* cpu, RAM* ram, uint64_t budget) {
+    uint64_t executed = 0;
 
-        case JNC: {     // jump if carry flat is not set
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-
-            bool cf = is_flag_set(cpu->FLAGS, FLAG_CARRY);
-
-            if (!cf) {
-                cpu->PC = addr;
-            }
-            break;
-        }
-
-        case JE: {      // jump if equal (CMP)
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-
-            bool zf = is_flag_set(cpu->FLAGS, FLAG_ZERO);
-
-            if (zf) {
-                cpu->PC = addr;
-            }
-            break;
-        }
-
-        case JNE: {     // jump if not equal (CMP)
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-
-            bool zf = is_flag_set(cpu->FLAGS, FLAG_ZERO);
-
-            if (!zf) {
-                cpu->PC = addr;
-            }
-            break;
-        }
-
-        case JL: {
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-
-            bool sf = is_flag_set(cpu->FLAGS, FLAG_SIGN);
-            bool of = is_flag_set(cpu->FLAGS, FLAG_OVERFLOW);
-
-            if (sf != of) {
-                cpu->PC = addr;
-            }
-            break;
-        }
-
-        case JLE: {
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-
-            bool sf = is_flag_set(cpu->FLAGS, FLAG_SIGN);
-            bool of = is_flag_set(cpu->FLAGS, FLAG_OVERFLOW);
-            bool zf = is_flag_set(cpu->FLAGS, FLAG_ZERO);
-
-            if (zf || (sf != of)) {
-                cpu->PC = addr;
-            }
-            break;
-        }
-
-        case JG: {
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-
-            bool sf = is_flag_set(cpu->FLAGS, FLAG_SIGN);
-            bool of = is_flag_set(cpu->FLAGS, FLAG_OVERFLOW);
-            bool zf = is_flag_set(cpu->FLAGS, FLAG_ZERO);
-
-            if (!zf && (sf == of)) {
-                cpu->PC = addr;
-            }
-            break;
-        }
-
-        case JGE: {
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-
-            bool sf = is_flag_set(cpu->FLAGS, FLAG_SIGN);
-            bool of = is_flag_set(cpu->FLAGS, FLAG_OVERFLOW);
-            bool zf = is_flag_set(cpu->FLAGS, FLAG_ZERO);
-
-            if (zf || (sf == of)) {
-                cpu->PC = addr;
-            }
-            break;
-        }
-
-        case JB: {
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-
-            if (is_flag_set(cpu->FLAGS, FLAG_CARRY)) {
-                cpu->PC = addr;
-            }
-            break;
-        }
-
-        case JA: {
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
-
-            bool cf = is_flag_set(cpu->FLAGS, FLAG_CARRY);
-            bool zf = is_flag_set(cpu->FLAGS, FLAG_ZERO);
-
-            if (!cf && !zf) {
-                cpu->PC = addr;
-            }
-            break;
-        }
-
-        case AND: {
-            uint8_t reg_to = ram_read(ram, cpu->PC++);
-            uint8_t reg_from = ram_read(ram, cpu->PC++);
-
-            if (register_out_of_bounds(cpu, reg_to)) exit(1);
-            if (register_out_of_bounds(cpu, reg_from)) exit(1);
-
-            uint8_t a = cpu->registers[reg_to];
-            uint8_t b = cpu->registers[reg_from];
-            uint8_t result = a & b;
-
-            set_flags_bitwise_ops(cpu, result);
-            cpu->registers[reg_to] = result;
-            break;
-        }
-
-        case OR: {
-            uint8_t reg_to = ram_read(ram, cpu->PC++);
-            uint8_t reg_from = ram_read(ram, cpu->PC++);
-
-            if (register_out_of_bounds(cpu, reg_to)) exit(1);
-            if (register_out_of_bounds(cpu, reg_from)) exit(1);
-
-            uint8_t a = cpu->registers[reg_to];
-            uint8_t b = cpu->registers[reg_from];
-            uint8_t result = a | b;
-
-            set_flags_bitwise_ops(cpu, result);
-            cpu->registers[reg_to] = result;
-            break;
-        }
-
-        case XOR: {
-            uint8_t reg_to = ram_read(ram, cpu->PC++);
-            uint8_t reg_from = ram_read(ram, cpu->PC++);
-
-            if (register_out_of_bounds(cpu, reg_to)) exit(1);
-            if (register_out_of_bounds(cpu, reg_from)) exit(1);
-
-            uint8_t a = cpu->registers[reg_to];
-            uint8_t b = cpu->registers[reg_from];
-            uint8_t result = a ^ b;
-
-            set_flags_bitwise_ops(cpu, result);
-            cpu->registers[reg_to] = result;
-            break;
-        }
-
-        case NOT: {
-            uint8_t reg_not = ram_read(ram, cpu->PC++);
-
-            if (register_out_of_bounds(cpu, reg_not)) exit(1);
-
-            uint8_t result = ~cpu->registers[reg_not];
-
-            set_flags_bitwise_ops(cpu, result);
-            cpu->registers[reg_not] = result;
-            break;
-        }
-
-        case PUSH: {
-            uint8_t reg_from = ram_read(ram, cpu->PC++);
-
-            if (register_out_of_bounds(cpu, reg_from)) exit(1);
-
-            uint8_t value = cpu->registers[reg_from];
-            ram_write(ram, --cpu->SP, value);
-            break;
-        }
-
-        case POP: {
-            uint8_t reg_to = ram_read(ram, cpu->PC++);
-
-            if (register_out_of_bounds(cpu, reg_to)) exit(1);
-
-            uint8_t value = ram_read(ram, cpu->SP++);
-            cpu->registers[reg_to] = value;
-            break;
-        }
+    while (executed < budget && !cpu->halted) {
+        cpu_step(cpu, ram);
+        executed++;
+    }
 
-        case CALL: {
-            uint16_t addr = ram_read(ram, cpu->PC++) << 8;
-            addr |= ram_read(ram, cpu->PC++);
+    return executed;
+}
 
-            // save return address: push PC onto stack
-            uint16_t value = cpu->PC;
-            uint8_t valHI = (value >> 8) & 0xFF;
-            uint8_t valLO = value & 0xFF;
-            ram_write(ram, --cpu->SP, valLO);
-            ram_write(ram, --cpu->SP, valHI);
+uint64_t cpu_run_cycles(CPU* cpu, RAM* ram, uint64_t until) {
+    uint64_t executed = 0;
 
-            cpu->PC = addr;
-            break;
-        }
+    while (cpu->cycles < until && !cpu->halted) {
+        cpu_step(cpu, ram);
+        executed++;
+    }
 
-        case RET: {
-            // 16 bit pop
-            uint16_t PC_addr = ram_read(ram, cpu->SP++) << 8;
-            PC_addr |= ram_read(ram, cpu->SP++);
+    return executed;
+}
 
-            cpu->PC = PC_addr;
-            break;
-        }
+uint64_t cpu_run_bus(CPU* cpu, Bus* bus, uint64_t budget) {
+    uint64_t executed = 0;
 
-        case HLT:       // end of program
-            cpu->halted = true;
-            break;
+    while (executed < budget && !cpu->halted) {
+        cpu_step_bus(cpu, bus);
+        executed++;
+    }
 
-        default:
-            cpu->halted = true;
-            break;
+    return executed;
+}
 
-    }
-}
\ No newline at end of file
+// EXECUTION ENGINES
+// plain engine, straight RAM access
+#define EXEC_NAME cpu_step
+#define EXEC_MEMORY RAM
+#define MEM_READ(mem, addr) ram_read(mem, addr)
+#define MEM_FETCH(mem, addr) ram_read(mem, addr)
+#define MEM_WRITE(mem, addr, value) ram_write(mem, addr, value)
+#define MEM_TEST_AND_SET(mem, addr) ram_test_and_set(mem, addr)
+#define MEM_COMPARE_EXCHANGE(mem, addr, expected, desired) ram_compare_exchange(mem, addr, expected, desired)
+#define EXEC_EDGE(mem, from, to) ((void)(from))
+#define EXEC_CALL(mem, from, to) ((void)(from))
+#define EXEC_RET(mem, from, to) ((void)(from))
+#include "cpu_exec.h"
+#undef EXEC_NAME
+#undef EXEC_MEMORY
+#undef MEM_READ
+#undef MEM_FETCH
+#undef MEM_WRITE
+#undef MEM_TEST_AND_SET
+#undef MEM_COMPARE_EXCHANGE
+#undef EXEC_EDGE
+#undef EXEC_CALL
+#undef EXEC_RET
+
+// bus engine, accesses to trapped pages call the bus trap (watchpoints etc.)
+#define EXEC_NAME cpu_step_bus
+#define EXEC_MEMORY Bus
+#define MEM_READ(mem, addr) bus_read(mem, addr)
+#define MEM_FETCH(mem, addr) bus_fetch(mem, addr)
+#define MEM_WRITE(mem, addr, value) bus_write(mem, addr, value)
+#define MEM_TEST_AND_SET(mem, addr) bus_test_and_set(mem, addr)
+#define MEM_COMPARE_EXCHANGE(mem, addr, expected, desired) bus_compare_exchange(mem, addr, expected, desired)
+#define EXEC_EDGE(mem, from, to) ((void)(from))
+#define EXEC_CALL(mem, from, to) ((void)(from))
+#define EXEC_RET(mem, from, to) ((void)(from))
+#include "cpu_exec.h"
+#undef EXEC_NAME
+#undef EXEC_MEMORY
+#undef MEM_READ
+#undef MEM_FETCH
+#undef MEM_WRITE
+#undef MEM_TEST_AND_SET
+#undef MEM_COMPARE_EXCHANGE
+#undef EXEC_EDGE
+#undef EXEC_CALL
+#undef EXEC_RET
@@ -4,7 +4,11 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include "config.h"
+#include "isa.h"
 #include "ram.h"
+#include "io.h"
+#include "bus.h"
 
 // flags
 #define FLAG_ZERO       0x01        // bit 0 --> 0001
@@ -12,12 +16,27 @@
 #define FLAG_SIGN       0x04        // bit 2 --> 0100
 #define FLAG_OVERFLOW   0x08        // bit 3 --> 1000
 
+// why a CPU stopped
+typedef enum {
+    STOP_NONE = 0,          // running
+    STOP_HALT,              // HLT
+    STOP_ILLEGAL,           // unknown opcode
+    STOP_BREAKPOINT,        // BRK, PC points at it
+    STOP_WATCHPOINT,        // watched memory was accessed
+} CpuStop;
+
+// fields every instruction touches come first, with 4 registers the whole CPU is 32 bytes
+// and a Guest (see sched.h) exactly one cache line
 typedef struct {
-    uint8_t registers[4];   // general purpose registers
     uint16_t PC;            // program counter
     uint16_t SP;            // stack pointer
     uint8_t FLAGS;          // flags register
     bool halted;            // stop execution flag
+    uint8_t stop;           // CpuStop, reason for halted
+    uint8_t id;             // core number, read by CPUID (0 on single core)
+    uint64_t cycles;        // clock cycles spent, see cpu_cycle_costs
+    uint8_t registers[CPU_REGISTER_SLOTS];  // general purpose registers
+    IO* io;                 // devices for IN/OUT, may be NULL
 } CPU;
 
 typedef enum {
@@ -27,47 +46,25 @@ typedef enum {
     D = 0x03,          // D register
 } Register;
 
-typedef enum {
-    NOP = 0x00,         // no operation
-    LDA = 0x01,         // load A from memory (accumulator)
-    LDB = 0x02,         // load B from memory
-    LDI = 0x03,         // load given value immediately into A
-    INC = 0x04,         // increment A
-    DEC = 0x05,         // decrement A
-    ADD = 0x06,         // add <register2> to <register1>: ADD A, B
-    SUB = 0x07,         // subtract B from A: SUB A, B
-    MUL = 0x08,         // multiply A with B: MUL A, B
-    STA = 0x09,         // store A to memory
-    STB = 0x0A,         // store B to memory
-    MOV = 0x0B,         // move to registers: MOV A, B
-    CMP = 0x0C,         // compare A to B
-    JMP = 0x0D,         // jump to address
-    JZ  = 0x0E,         // jump if zero flag is set
-    JNZ = 0x0F,         // jump if zero flag is not set
-    JC  = 0x10,         // jump if carry flag is set
-    JNC = 0x11,         // jump if carry flag is not set
-    JE  = 0x12,         // jump if equal
-    JNE = 0x13,         // jump if not equal
-    JL  = 0x14,         // jump if less (signed)
-    JG  = 0x15,         // jump if greater (signed)
-    JB  = 0x16,         // jump if below (unsigned)
-    JA  = 0x17,         // jump if above (unsigned)
-    AND = 0x18,         // bitwise AND: AND <dest>, <src>
-    OR  = 0x19,         // bitwise OR: OR <dest>, <src>
-    XOR = 0x1A,         // bitwise XOR: XOR <dest>, <src>
-    NOT = 0x1B,         // bitwise NOT: NOT <src>
-    PUSH = 0x1C,        // push onto stack
-    POP = 0x1D,         // pop off stack
-    CALL = 0x1E,        // call <addr>
-    RET = 0x1F,         // return
-    JLE = 0x20,         // jump if less or equal
-    JGE = 0x21,         // jump if greater or equal
-    HLT = 0xFF          // halt CPU
-} Instruction;
+
+// DECODING, generated from isa.def
+extern const OpcodeInfo cpu_opcodes[256];
+
+// TIMING
+// cycles per opcode (cpu_opcodes[].cycles, packed for the interpreter),
+// conditional jumps cost CPU_CYCLES_BRANCH_TAKEN more when taken
+extern const uint8_t cpu_cycle_costs[256];
+#define CPU_CYCLES_BRANCH_TAKEN 1
 
 // CPU
 void cpu_reset(CPU *cpu);
 void cpu_step(CPU* cpu, RAM* ram);
+uint64_t cpu_run(CPU* cpu, RAM* ram, uint64_t budget);     // returns number of executed instructions
+uint64_t cpu_run_cycles(CPU* cpu, RAM* ram, uint64_t until);    // runs until cpu->cycles >= until
+
+// same as above, but memory goes through the bus page table
+void cpu_step_bus(CPU* cpu, Bus* bus);
+uint64_t cpu_run_bus(CPU* cpu, Bus* bus, uint64_t budget);
 
 // FLAG LOGIC
 void set_flag(uint8_t* flags, uint8_t mask);
@@ -83,14 +80,37 @@ bool is_flag_set(uint8_t flags, uint8_t mask);
 
 void set_flags_add(CPU* cpu, uint8_t reg1, uint8_t reg2, uint16_t result);
 void set_flags_sub(CPU* cpu, uint8_t reg1, uint8_t reg2, uint16_t result);
+void set_flags_sbb(CPU* cpu, uint8_t reg1, uint8_t reg2, uint8_t borrow, uint16_t result);
 void set_flags_inc(CPU* cpu, uint8_t original, uint16_t result);
 void set_flags_dec(CPU* cpu, uint8_t original, uint16_t result);
 void set_flags_bitwise_ops(CPU* cpu, uint8_t result);
 void set_flags_mul(CPU* cpu, uint16_t result);
+void set_flags_shift(CPU* cpu, uint8_t original, uint8_t result, bool carry);
 
 // REGISTER BOUNDS CHECK
 bool register_out_of_bounds(CPU* cpu, uint8_t registers);
 
+// register operands are validated once at load time (cpu_validate_program),
+// the interpreter only masks them so the bound is a compile-time constant.
+// With a CPU_NUM_REGISTERS that is not a power of two, an unvalidated operand
+// (self-modified code) between CPU_NUM_REGISTERS and CPU_REGISTER_SLOTS - 1 reaches
+// a spare slot: memory safe, but not a register any tool shows
+#define REG(cpu, r) ((cpu)->registers[(r) & CPU_REGISTER_MASK])
+_Static_assert((CPU_REGISTER_SLOTS & CPU_REGISTER_MASK) == 0 && CPU_REGISTER_SLOTS >= CPU_NUM_REGISTERS,
+    "the register file must be a power of two covering every register");
+
+#ifdef DEBUG
+#define CHECK_REGISTER(cpu, r) \
+    do { \
+        if (register_out_of_bounds(cpu, r)) exit(1); \
+    } while (0)
+#else
+#define CHECK_REGISTER(cpu, r) ((void)0)
+#endif
+
+// PROGRAM VALIDATION
+bool cpu_validate_program(RAM* ram, uint16_t start, size_t size, uint16_t* bad_address);
+
 // MISC
 size_t get_number_of_registers(CPU* cpu);
 
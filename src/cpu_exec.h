@@ -0,0 +1,573 @@
+// Instruction semantics of the CPU, no include guard on purpose.
+// cpu.c includes this file once per execution engine, after defining:
+//   EXEC_NAME                     name of the step function
+//   EXEC_MEMORY                   type the engine reads memory through (RAM or Bus)
+//   MEM_READ(mem, addr)           MEM_WRITE(mem, addr, value)
+//   MEM_FETCH(mem, addr)          read of an opcode or operand byte
+//   MEM_TEST_AND_SET(mem, addr)   MEM_COMPARE_EXCHANGE(mem, addr, expected, desired)
+//   EXEC_EDGE(mem, from, to)      taken jump from the instruction at `from`
+//   EXEC_CALL(mem, from, to)      CALL from `from` to the routine at `to`
+//   EXEC_RET(mem, from, to)       RET from `from` back to `to`
+
+void EXEC_NAME(CPU* cpu, EXEC_MEMORY* mem) {
+    if (cpu->halted) return;
+
+    uint16_t start = cpu->PC;
+    uint8_t opcode = MEM_FETCH(mem, cpu->PC++);
+    cpu->cycles += cpu_cycle_costs[opcode];
+
+    switch (opcode) {
+        case NOP:
+            break;
+
+        case LDA: {
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+            cpu->registers[A] = MEM_READ(mem, addr);
+
+            if (cpu->registers[A] == 0) set_flag(&cpu->FLAGS, FLAG_ZERO);
+            else clear_flag(&cpu->FLAGS, FLAG_ZERO);
+            break;
+        }
+
+        case LDB: {
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+            cpu->registers[B] = MEM_READ(mem, addr);
+            break;
+        }
+
+        case LDI: {
+            uint8_t immediate_value = MEM_FETCH(mem, cpu->PC++);
+            cpu->registers[A] = immediate_value;
+
+            if (cpu->registers[A] == 0) set_flag(&cpu->FLAGS, FLAG_ZERO);
+            else clear_flag(&cpu->FLAGS, FLAG_ZERO);
+            break;
+        }
+
+        case INC: {      // not updating the carry flag on purpose
+            uint16_t result = cpu->registers[A] + 1;
+            uint8_t original = cpu->registers[A];
+
+            set_flags_inc(cpu, original, result);
+            cpu->registers[A] = result;
+            break;
+        }
+
+        case DEC: {      // not updating the carry flag on purpose
+            uint16_t result = cpu->registers[A] - 1;
+            uint8_t original = cpu->registers[A];
+
+            set_flags_dec(cpu, original, result);
+            cpu->registers[A] = result;
+            break;
+        }
+
+        case ADD: {     // ADD C, B
+            uint8_t reg_to = MEM_FETCH(mem, cpu->PC++);
+            uint8_t reg_from = MEM_FETCH(mem, cpu->PC++);
+
+            CHECK_REGISTER(cpu, reg_to);
+            CHECK_REGISTER(cpu, reg_from);
+
+            uint16_t a = (uint16_t)REG(cpu, reg_to);
+            uint16_t b = (uint16_t)REG(cpu, reg_from);
+            uint16_t result = a + b;
+
+            set_flags_add(cpu, a, b, result);
+            REG(cpu, reg_to) = (uint8_t)result;
+            break;
+        }
+
+        case SUB: {     // SUB C, B
+            uint8_t reg_to = MEM_FETCH(mem, cpu->PC++);
+            uint8_t reg_from = MEM_FETCH(mem, cpu->PC++);
+
+            CHECK_REGISTER(cpu, reg_to);
+            CHECK_REGISTER(cpu, reg_from);
+
+            uint16_t a = (uint16_t)REG(cpu, reg_to);
+            uint16_t b = (uint16_t)REG(cpu, reg_from);
+            uint16_t result = a - b;
+
+            set_flags_sub(cpu, a, b, result);
+            REG(cpu, reg_to) = (uint8_t)result;
+            break;
+        }
+
+        case ADC: {     // ADC C, B
+            uint8_t reg_to = MEM_FETCH(mem, cpu->PC++);
+            uint8_t reg_from = MEM_FETCH(mem, cpu->PC++);
+
+            CHECK_REGISTER(cpu, reg_to);
+            CHECK_REGISTER(cpu, reg_from);
+
+            uint16_t a = (uint16_t)REG(cpu, reg_to);
+            uint16_t b = (uint16_t)REG(cpu, reg_from);
+            uint16_t result = a + b + is_flag_set(cpu->FLAGS, FLAG_CARRY);
+
+            set_flags_add(cpu, a, b, result);
+            REG(cpu, reg_to) = (uint8_t)result;
+            break;
+        }
+
+        case SBB: {     // SBB C, B
+            uint8_t reg_to = MEM_FETCH(mem, cpu->PC++);
+            uint8_t reg_from = MEM_FETCH(mem, cpu->PC++);
+
+            CHECK_REGISTER(cpu, reg_to);
+            CHECK_REGISTER(cpu, reg_from);
+
+            uint8_t borrow = is_flag_set(cpu->FLAGS, FLAG_CARRY);
+            uint16_t a = (uint16_t)REG(cpu, reg_to);
+            uint16_t b = (uint16_t)REG(cpu, reg_from);
+            uint16_t result = a - b - borrow;
+
+            set_flags_sbb(cpu, a, b, borrow, result);
+            REG(cpu, reg_to) = (uint8_t)result;
+            break;
+        }
+
+        case MUL: {     // MUL D, B
+            uint8_t reg_to = MEM_FETCH(mem, cpu->PC++);
+            uint8_t reg_from = MEM_FETCH(mem, cpu->PC++);
+
+            CHECK_REGISTER(cpu, reg_to);
+            CHECK_REGISTER(cpu, reg_from);
+
+            uint16_t a = (uint16_t)REG(cpu, reg_to);
+            uint16_t b = (uint16_t)REG(cpu, reg_from);
+            uint16_t result = a * b;
+
+            set_flags_mul(cpu, result);
+            REG(cpu, reg_to) = (uint8_t) (result & 0xFF); // store low
+            break;
+        }
+
+        case STA: {
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+            MEM_WRITE(mem, addr, cpu->registers[A]);
+            break;
+        }
+
+        case STB: {
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+            MEM_WRITE(mem, addr, cpu->registers[B]);
+            break;
+        }
+
+        case MOV: {     // move B register into A: MOV A, B
+            uint8_t reg_to = MEM_FETCH(mem, cpu->PC++);
+            uint8_t reg_from = MEM_FETCH(mem, cpu->PC++);
+
+            CHECK_REGISTER(cpu, reg_to);
+            CHECK_REGISTER(cpu, reg_from);
+
+            REG(cpu, reg_to) = REG(cpu, reg_from);
+
+            break;
+        }
+
+        case CMP: {     // CMP B, D
+            uint8_t reg_to = MEM_FETCH(mem, cpu->PC++);
+            uint8_t reg_from = MEM_FETCH(mem, cpu->PC++);
+
+            CHECK_REGISTER(cpu, reg_to);
+            CHECK_REGISTER(cpu, reg_from);
+
+            uint16_t a = (uint16_t)REG(cpu, reg_to);
+            uint16_t b = (uint16_t)REG(cpu, reg_from);
+            uint16_t result = a - b;
+
+            set_flags_sub(cpu, a, b, result);
+            break;
+        }
+
+        case JMP: {     // unconditional jump
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+            EXEC_EDGE(mem, start, addr);
+            cpu->PC = addr;
+            break;
+        }
+
+        case JZ: {      // jump if zero
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+
+            bool zf = is_flag_set(cpu->FLAGS, FLAG_ZERO);
+            if (zf) {
+                EXEC_EDGE(mem, start, addr);
+                cpu->cycles += CPU_CYCLES_BRANCH_TAKEN;
+                cpu->PC = addr;
+            }
+            break;
+        }
+
+        case JNZ: {     // jump if not zero
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+
+            bool zf = is_flag_set(cpu->FLAGS, FLAG_ZERO);
+            if (!zf) {
+                EXEC_EDGE(mem, start, addr);
+                cpu->cycles += CPU_CYCLES_BRANCH_TAKEN;
+                cpu->PC = addr;
+            }
+            break;
+        }
+
+        case JC: {      // jump if carry flag is set
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+
+            bool cf = is_flag_set(cpu->FLAGS, FLAG_CARRY);
+
+            if (cf) {
+                EXEC_EDGE(mem, start, addr);
+                cpu->cycles += CPU_CYCLES_BRANCH_TAKEN;
+                cpu->PC = addr;
+            }
+            break;
+        }
+
+        case JNC: {     // jump if carry flat is not set
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+
+            bool cf = is_flag_set(cpu->FLAGS, FLAG_CARRY);
+
+            if (!cf) {
+                EXEC_EDGE(mem, start, addr);
+                cpu->cycles += CPU_CYCLES_BRANCH_TAKEN;
+                cpu->PC = addr;
+            }
+            break;
+        }
+
+        case JE: {      // jump if equal (CMP)
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+
+            bool zf = is_flag_set(cpu->FLAGS, FLAG_ZERO);
+
+            if (zf) {
+                EXEC_EDGE(mem, start, addr);
+                cpu->cycles += CPU_CYCLES_BRANCH_TAKEN;
+                cpu->PC = addr;
+            }
+            break;
+        }
+
+        case JNE: {     // jump if not equal (CMP)
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+
+            bool zf = is_flag_set(cpu->FLAGS, FLAG_ZERO);
+
+            if (!zf) {
+                EXEC_EDGE(mem, start, addr);
+                cpu->cycles += CPU_CYCLES_BRANCH_TAKEN;
+                cpu->PC = addr;
+            }
+            break;
+        }
+
+        case JL: {
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+
+            bool sf = is_flag_set(cpu->FLAGS, FLAG_SIGN);
+            bool of = is_flag_set(cpu->FLAGS, FLAG_OVERFLOW);
+
+            if (sf != of) {
+                EXEC_EDGE(mem, start, addr);
+                cpu->cycles += CPU_CYCLES_BRANCH_TAKEN;
+                cpu->PC = addr;
+            }
+            break;
+        }
+
+        case JLE: {
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+
+            bool sf = is_flag_set(cpu->FLAGS, FLAG_SIGN);
+            bool of = is_flag_set(cpu->FLAGS, FLAG_OVERFLOW);
+            bool zf = is_flag_set(cpu->FLAGS, FLAG_ZERO);
+
+            if (zf || (sf != of)) {
+                EXEC_EDGE(mem, start, addr);
+                cpu->cycles += CPU_CYCLES_BRANCH_TAKEN;
+                cpu->PC = addr;
+            }
+            break;
+        }
+
+        case JG: {
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+
+            bool sf = is_flag_set(cpu->FLAGS, FLAG_SIGN);
+            bool of = is_flag_set(cpu->FLAGS, FLAG_OVERFLOW);
+            bool zf = is_flag_set(cpu->FLAGS, FLAG_ZERO);
+
+            if (!zf && (sf == of)) {
+                EXEC_EDGE(mem, start, addr);
+                cpu->cycles += CPU_CYCLES_BRANCH_TAKEN;
+                cpu->PC = addr;
+            }
+            break;
+        }
+
+        case JGE: {
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+
+            bool sf = is_flag_set(cpu->FLAGS, FLAG_SIGN);
+            bool of = is_flag_set(cpu->FLAGS, FLAG_OVERFLOW);
+            bool zf = is_flag_set(cpu->FLAGS, FLAG_ZERO);
+
+            if (zf || (sf == of)) {
+                EXEC_EDGE(mem, start, addr);
+                cpu->cycles += CPU_CYCLES_BRANCH_TAKEN;
+                cpu->PC = addr;
+            }
+            break;
+        }
+
+        case JB: {
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+
+            if (is_flag_set(cpu->FLAGS, FLAG_CARRY)) {
+                EXEC_EDGE(mem, start, addr);
+                cpu->cycles += CPU_CYCLES_BRANCH_TAKEN;
+                cpu->PC = addr;
+            }
+            break;
+        }
+
+        case JA: {
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+
+            bool cf = is_flag_set(cpu->FLAGS, FLAG_CARRY);
+            bool zf = is_flag_set(cpu->FLAGS, FLAG_ZERO);
+
+            if (!cf && !zf) {
+                EXEC_EDGE(mem, start, addr);
+                cpu->cycles += CPU_CYCLES_BRANCH_TAKEN;
+                cpu->PC = addr;
+            }
+            break;
+        }
+
+        case AND: {
+            uint8_t reg_to = MEM_FETCH(mem, cpu->PC++);
+            uint8_t reg_from = MEM_FETCH(mem, cpu->PC++);
+
+            CHECK_REGISTER(cpu, reg_to);
+            CHECK_REGISTER(cpu, reg_from);
+
+            uint8_t a = REG(cpu, reg_to);
+            uint8_t b = REG(cpu, reg_from);
+            uint8_t result = a & b;
+
+            set_flags_bitwise_ops(cpu, result);
+            REG(cpu, reg_to) = result;
+            break;
+        }
+
+        case OR: {
+            uint8_t reg_to = MEM_FETCH(mem, cpu->PC++);
+            uint8_t reg_from = MEM_FETCH(mem, cpu->PC++);
+
+            CHECK_REGISTER(cpu, reg_to);
+            CHECK_REGISTER(cpu, reg_from);
+
+            uint8_t a = REG(cpu, reg_to);
+            uint8_t b = REG(cpu, reg_from);
+            uint8_t result = a | b;
+
+            set_flags_bitwise_ops(cpu, result);
+            REG(cpu, reg_to) = result;
+            break;
+        }
+
+        case XOR: {
+            uint8_t reg_to = MEM_FETCH(mem, cpu->PC++);
+            uint8_t reg_from = MEM_FETCH(mem, cpu->PC++);
+
+            CHECK_REGISTER(cpu, reg_to);
+            CHECK_REGISTER(cpu, reg_from);
+
+            uint8_t a = REG(cpu, reg_to);
+            uint8_t b = REG(cpu, reg_from);
+            uint8_t result = a ^ b;
+
+            set_flags_bitwise_ops(cpu, result);
+            REG(cpu, reg_to) = result;
+            break;
+        }
+
+        case NOT: {
+            uint8_t reg_not = MEM_FETCH(mem, cpu->PC++);
+
+            CHECK_REGISTER(cpu, reg_not);
+
+            uint8_t result = ~REG(cpu, reg_not);
+
+            set_flags_bitwise_ops(cpu, result);
+            REG(cpu, reg_not) = result;
+            break;
+        }
+
+        case SHL:
+        case SHR:
+        case RCL:
+        case RCR: {     // SHL B
+            uint8_t reg_shift = MEM_FETCH(mem, cpu->PC++);
+
+            CHECK_REGISTER(cpu, reg_shift);
+
+            uint8_t original = REG(cpu, reg_shift);
+            uint8_t carry_in = is_flag_set(cpu->FLAGS, FLAG_CARRY);
+            uint8_t result;
+            bool carry;
+            if (opcode == SHL || opcode == RCL) {
+                result = (uint8_t)(original << 1 | (opcode == RCL ? carry_in : 0));
+                carry = original & 0x80;
+            } else {
+                result = (uint8_t)(original >> 1 | (opcode == RCR ? carry_in << 7 : 0));
+                carry = original & 0x01;
+            }
+
+            set_flags_shift(cpu, original, result, carry);
+            REG(cpu, reg_shift) = result;
+            break;
+        }
+
+        case PUSH: {
+            uint8_t reg_from = MEM_FETCH(mem, cpu->PC++);
+
+            CHECK_REGISTER(cpu, reg_from);
+
+            uint8_t value = REG(cpu, reg_from);
+            MEM_WRITE(mem, --cpu->SP, value);
+            break;
+        }
+
+        case POP: {
+            uint8_t reg_to = MEM_FETCH(mem, cpu->PC++);
+
+            CHECK_REGISTER(cpu, reg_to);
+
+            uint8_t value = MEM_READ(mem, cpu->SP++);
+            REG(cpu, reg_to) = value;
+            break;
+        }
+
+        case CALL: {
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+
+            // save return address: push PC onto stack
+            uint16_t value = cpu->PC;
+            uint8_t valHI = (value >> 8) & 0xFF;
+            uint8_t valLO = value & 0xFF;
+            MEM_WRITE(mem, --cpu->SP, valLO);
+            MEM_WRITE(mem, --cpu->SP, valHI);
+
+            EXEC_CALL(mem, start, addr);
+
+            cpu->PC = addr;
+            break;
+        }
+
+        case RET: {
+            // 16 bit pop
+            uint16_t PC_addr = MEM_READ(mem, cpu->SP++) << 8;
+            PC_addr |= MEM_READ(mem, cpu->SP++);
+
+            EXEC_RET(mem, start, PC_addr);
+            cpu->PC = PC_addr;
+            break;
+        }
+
+        case HCALL: {   // patched over a routine entry, the routine's CALL got us here
+            uint8_t id = MEM_FETCH(mem, cpu->PC++);
+            if (!native_call(cpu, id)) {
+                cpu->halted = true;
+                cpu->stop = STOP_ILLEGAL;
+                break;
+            }
+
+            uint16_t PC_addr = MEM_READ(mem, cpu->SP++) << 8;
+            PC_addr |= MEM_READ(mem, cpu->SP++);
+
+            EXEC_RET(mem, start, PC_addr);
+            cpu->PC = PC_addr;
+            break;
+        }
+
+        case TAS: {     // TAS <addr>
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+
+            cpu->registers[A] = MEM_TEST_AND_SET(mem, addr);
+            SET_FLAG_IF(cpu, cpu->registers[A] == 0, FLAG_ZERO);
+            break;
+        }
+
+        case CAS: {     // CAS <addr>, compares with A and stores B
+            uint16_t addr = MEM_FETCH(mem, cpu->PC++) << 8;
+            addr |= MEM_FETCH(mem, cpu->PC++);
+
+            uint8_t expected = cpu->registers[A];
+            bool swapped = MEM_COMPARE_EXCHANGE(mem, addr, &expected, cpu->registers[B]);
+
+            cpu->registers[A] = expected;
+            SET_FLAG_IF(cpu, swapped, FLAG_ZERO);
+            break;
+        }
+
+        case CPUID:
+            cpu->registers[A] = cpu->id;
+            break;
+
+        case IN: {      // IN <port>
+            uint8_t port = MEM_FETCH(mem, cpu->PC++);
+            cpu->registers[A] = io_in(cpu->io, port);
+
+            SET_FLAG_IF(cpu, cpu->registers[A] == 0, FLAG_ZERO);
+            break;
+        }
+
+        case OUT: {     // OUT <port>
+            uint8_t port = MEM_FETCH(mem, cpu->PC++);
+            io_out(cpu->io, port, cpu->registers[A]);
+            break;
+        }
+
+        case BRK:       // breakpoint patched in by the debugger, stop in front of it
+            cpu->PC--;
+            cpu->halted = true;
+            cpu->stop = STOP_BREAKPOINT;
+            break;
+
+        case HLT:       // end of program
+            cpu->halted = true;
+            cpu->stop = STOP_HALT;
+            break;
+
+        default:
+            cpu->halted = true;
+            cpu->stop = STOP_ILLEGAL;
+            break;
+
+    }
+}
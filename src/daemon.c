@@ -0,0 +1,330 @@
+#include "daemon.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "cpu.h"
+#include "bus.h"
+#include "io.h"
+#include "rom.h"
+#include "snapshot.h"
+
+#define NO_PROGRAM UINT32_MAX
+
+typedef struct {
+    CPU cpu;
+    RAM* ram;
+    Bus bus;
+    Snapshot snapshot;
+    uint32_t program;           // loaded image, NO_PROGRAM before the first job
+    IO io;
+    IoBuffer buffer;
+    uint8_t output[DAEMON_MAX_OUTPUT];
+} Instance;
+
+typedef struct {
+    uint64_t default_budget;
+
+    pthread_mutex_t lock;       // free instances and registering programs
+    pthread_cond_t available;
+    Instance** free;
+    size_t free_count;
+
+    RAM* programs[DAEMON_MAX_PROGRAMS];     // images, never removed
+    _Atomic uint32_t program_count;
+} Daemon;
+
+typedef struct {
+    Daemon* daemon;
+    int fd;
+} Connection;
+
+// growable byte buffer for the requests and responses of a connection
+typedef struct {
+    uint8_t* data;
+    size_t length;
+    size_t capacity;
+} Buffer;
+
+static void reserve(Buffer* buffer, size_t bytes) {
+    if (buffer->capacity - buffer->length >= bytes) return;
+
+    size_t capacity = buffer->capacity ? buffer->capacity : 65536;
+    while (capacity - buffer->length < bytes) capacity *= 2;
+    buffer->data = realloc(buffer->data, capacity);
+    if (!buffer->data) {
+        fprintf(stderr, "Error: Could not allocate connection buffer\n");
+        exit(1);
+    }
+    buffer->capacity = capacity;
+}
+
+static void append(Buffer* buffer, const void* data, size_t length) {
+    reserve(buffer, length);
+    memcpy(&buffer->data[buffer->length], data, length);
+    buffer->length += length;
+}
+
+// INSTANCES
+static Instance* acquire(Daemon* daemon) {
+    pthread_mutex_lock(&daemon->lock);
+    while (daemon->free_count == 0) pthread_cond_wait(&daemon->available, &daemon->lock);
+    Instance* instance = daemon->free[--daemon->free_count];
+    pthread_mutex_unlock(&daemon->lock);
+    return instance;
+}
+
+static void release(Daemon* daemon, Instance* instance) {
+    pthread_mutex_lock(&daemon->lock);
+    daemon->free[daemon->free_count++] = instance;
+    pthread_cond_signal(&daemon->available);
+    pthread_mutex_unlock(&daemon->lock);
+}
+
+// REQUESTS
+static void respond(Buffer* out, const DaemonHeader* request, uint8_t status, const void* body, size_t length) {
+    DaemonHeader header = { (uint32_t)length, request->type, status, 0, request->tag };
+    append(out, &header, sizeof(header));
+    if (length) append(out, body, length);
+}
+
+static void register_program(Daemon* daemon, const DaemonHeader* request, const uint8_t* body, Buffer* out) {
+    if (request->length > RAM_SIZE) {
+        respond(out, request, DAEMON_INVALID_PROGRAM, NULL, 0);
+        return;
+    }
+
+    RAM* image = ram_alloc(1);
+    if (!image) {
+        fprintf(stderr, "Error: Could not allocate program memory\n");
+        exit(1);
+    }
+    rom_load(image, body, request->length);
+
+    uint16_t bad_address;
+    if (!cpu_validate_program(image, 0x0000, request->length, &bad_address)) {
+        ram_free(image, 1);
+        respond(out, request, DAEMON_INVALID_PROGRAM, NULL, 0);
+        return;
+    }
+
+    pthread_mutex_lock(&daemon->lock);
+    uint32_t id = atomic_load(&daemon->program_count);
+    if (id < DAEMON_MAX_PROGRAMS) {
+        daemon->programs[id] = image;
+        atomic_store(&daemon->program_count, id + 1);
+    }
+    pthread_mutex_unlock(&daemon->lock);
+
+    if (id == DAEMON_MAX_PROGRAMS) {
+        ram_free(image, 1);
+        respond(out, request, DAEMON_TOO_MANY_PROGRAMS, NULL, 0);
+        return;
+    }
+    DaemonRegistered registered = { id };
+    respond(out, request, DAEMON_OK, &registered, sizeof(registered));
+}
+
+static void run_job(Daemon* daemon, Instance* instance, const DaemonHeader* request, const uint8_t* body, Buffer* out) {
+    DaemonRun run;
+    if (request->length < sizeof(run)) {
+        respond(out, request, DAEMON_BAD_REQUEST, NULL, 0);
+        return;
+    }
+    memcpy(&run, body, sizeof(run));
+    if (run.input_length != request->length - sizeof(run)) {
+        respond(out, request, DAEMON_BAD_REQUEST, NULL, 0);
+        return;
+    }
+    if (run.program >= atomic_load(&daemon->program_count)) {
+        respond(out, request, DAEMON_UNKNOWN_PROGRAM, NULL, 0);
+        return;
+    }
+
+    // back to the program image: dirty pages only, unless the program changes
+    if (instance->program == run.program) {
+        snapshot_restore(&instance->snapshot);
+    } else {
+        snapshot_load(&instance->snapshot, daemon->programs[run.program]);
+        instance->program = run.program;
+    }
+
+    CPU* cpu = &instance->cpu;
+    cpu_reset(cpu);
+    instance->buffer = (IoBuffer){ body + sizeof(run), run.input_length, 0, instance->output, 0, DAEMON_MAX_OUTPUT };
+    io_buffer(&instance->io, &instance->buffer);
+    cpu->io = &instance->io;
+
+    uint64_t executed = cpu_run_bus(cpu, &instance->bus, run.budget ? run.budget : daemon->default_budget);
+
+    DaemonResult result = {
+        .instructions = executed,
+        .cycles = cpu->cycles,
+        .pc = cpu->PC,
+        .sp = cpu->SP,
+        .flags = cpu->FLAGS,
+        .halted = cpu->halted,
+        .stop = cpu->stop,
+        .register_count = (uint8_t)CPU_NUM_REGISTERS,
+        .output_length = (uint32_t)instance->buffer.output_length,
+    };
+    size_t length = sizeof(result) + CPU_NUM_REGISTERS + result.output_length;
+
+    DaemonHeader header = { (uint32_t)length, request->type, DAEMON_OK, 0, request->tag };
+    reserve(out, sizeof(header) + length);
+    append(out, &header, sizeof(header));
+    append(out, &result, sizeof(result));
+    append(out, cpu->registers, CPU_NUM_REGISTERS);
+    append(out, instance->output, result.output_length);
+}
+
+static bool write_all(int fd, const uint8_t* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        data += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+static void* serve(void* arg) {
+    Connection* connection = arg;
+    Daemon* daemon = connection->daemon;
+    int fd = connection->fd;
+    free(connection);
+
+    Buffer in = { 0 }, out = { 0 };
+
+    for (;;) {
+        reserve(&in, 65536);
+        ssize_t received = read(fd, &in.data[in.length], in.capacity - in.length);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) break;
+        in.length += (size_t)received;
+
+        // answer every complete request of this read, then write once; the jobs of one
+        // read share an instance, taken for the first and given back before the write
+        Instance* instance = NULL;
+        size_t position = 0;
+        bool bad = false;
+        while (in.length - position >= sizeof(DaemonHeader)) {
+            DaemonHeader header;
+            memcpy(&header, &in.data[position], sizeof(header));
+            if (header.length > DAEMON_MAX_BODY) {
+                bad = true;
+                break;
+            }
+            if (in.length - position - sizeof(header) < header.length) {
+                reserve(&in, sizeof(header) + header.length);
+                break;
+            }
+
+            const uint8_t* body = &in.data[position + sizeof(header)];
+            switch (header.type) {
+                case DAEMON_REGISTER:
+                    register_program(daemon, &header, body, &out);
+                    break;
+                case DAEMON_RUN:
+                    if (!instance) instance = acquire(daemon);
+                    run_job(daemon, instance, &header, body, &out);
+                    break;
+                default:
+                    respond(&out, &header, DAEMON_BAD_REQUEST, NULL, 0);
+                    break;
+            }
+            position += sizeof(header) + header.length;
+        }
+
+        if (instance) release(daemon, instance);
+
+        memmove(in.data, &in.data[position], in.length - position);
+        in.length -= position;
+
+        if (!write_all(fd, out.data, out.length) || bad) break;
+        out.length = 0;
+    }
+
+    close(fd);
+    free(in.data);
+    free(out.data);
+    return NULL;
+}
+
+void daemon_run(const char* socket_path, size_t pool, uint64_t default_budget) {
+    static Daemon daemon;
+    if (pool == 0) pool = 1;
+
+    daemon.default_budget = default_budget ? default_budget : DAEMON_DEFAULT_BUDGET;
+    pthread_mutex_init(&daemon.lock, NULL);
+    pthread_cond_init(&daemon.available, NULL);
+
+    // the pool: every instance is zeroed and touched once now, not on the first job
+    Instance* instances = calloc(pool, sizeof(Instance));
+    RAM* memory = ram_alloc(pool);
+    daemon.free = calloc(pool, sizeof(Instance*));
+    if (!instances || !memory || !daemon.free) {
+        fprintf(stderr, "Error: Could not allocate %zu instances\n", pool);
+        exit(1);
+    }
+    for (size_t i = 0; i < pool; i++) {
+        Instance* instance = &instances[i];
+        instance->ram = &memory[i];
+        memset(instance->ram, 0, sizeof(RAM));
+        bus_init(&instance->bus, instance->ram);
+        snapshot_init(&instance->snapshot, &instance->bus);
+        instance->program = NO_PROGRAM;
+        daemon.free[daemon.free_count++] = instance;
+    }
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (listen_fd < 0 || strlen(socket_path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Error: Could not create socket %s\n", socket_path);
+        exit(1);
+    }
+    strcpy(address.sun_path, socket_path);
+    unlink(socket_path);
+    if (bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listen_fd, 64) != 0) {
+        fprintf(stderr, "Error: Could not listen on %s\n", socket_path);
+        exit(1);
+    }
+
+    // a client that goes away must not kill the daemon
+    signal(SIGPIPE, SIG_IGN);
+    printf("Daemon: listening on %s, %zu instances\n", socket_path, pool);
+    fflush(stdout);
+
+    for (;;) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            fprintf(stderr, "Error: accept failed on %s\n", socket_path);
+            exit(1);
+        }
+
+        Connection* connection = malloc(sizeof(Connection));
+        pthread_t thread;
+        if (!connection) {
+            close(fd);
+            continue;
+        }
+        *connection = (Connection){ &daemon, fd };
+        if (pthread_create(&thread, NULL, serve, connection) != 0) {
+            close(fd);
+            free(connection);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
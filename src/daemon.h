@@ -0,0 +1,25 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "daemon_protocol.h"
+
+// Warm-pool daemon: runs jobs sent over a Unix domain socket.
+//
+// Programs are registered once and kept as complete memory images. The pool holds
+// pre-initialized CPU/RAM instances; the run requests of one read (a pipelined batch)
+// take one and give it back before the replies are written, so idle connections hold
+// none. A job resets the CPU and restores only the pages the previous job wrote (see
+// snapshot.h), the whole image is only copied when an instance switches programs.
+//
+// All complete requests of one read are answered with a single write.
+
+#define DAEMON_MAX_PROGRAMS     1024
+#define DAEMON_DEFAULT_POOL     4
+#define DAEMON_DEFAULT_BUDGET   10000000
+
+// serves until the process is killed
+void daemon_run(const char* socket_path, size_t pool, uint64_t default_budget);
+
+#endif //DAEMON_H
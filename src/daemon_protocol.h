@@ -0,0 +1,66 @@
+#ifndef DAEMON_PROTOCOL_H
+#define DAEMON_PROTOCOL_H
+
+#include <stdint.h>
+
+// Wire format of the emulator daemon (see daemon.h), shared with tools/client.
+// Plain C, also included from C++. Integers are in host byte order, the socket is local.
+//
+// Every message is a DaemonHeader followed by `length` bytes of body. Responses carry
+// the tag of their request, requests on one connection are answered in order, so a
+// client can send many requests before reading the answers (pipelining).
+//
+//   DAEMON_REGISTER   body: program bytes, loaded at 0x0000
+//                     reply: DaemonRegistered
+//   DAEMON_RUN        body: DaemonRun, then input_length input bytes for IN port 0
+//                     reply: DaemonResult, then register_count registers, then output_length
+//                     bytes the guest wrote with OUT to port 0
+
+#define DAEMON_MAX_BODY         (1 << 20)
+#define DAEMON_MAX_OUTPUT       65536
+
+enum {
+    DAEMON_REGISTER = 1,
+    DAEMON_RUN = 2,
+};
+
+enum {
+    DAEMON_OK = 0,
+    DAEMON_BAD_REQUEST,         // unknown type or malformed body
+    DAEMON_UNKNOWN_PROGRAM,
+    DAEMON_INVALID_PROGRAM,     // too large or invalid register operands
+    DAEMON_TOO_MANY_PROGRAMS,
+};
+
+typedef struct {
+    uint32_t length;            // body bytes after the header
+    uint8_t type;
+    uint8_t status;             // responses only
+    uint16_t reserved;
+    uint32_t tag;               // chosen by the client, echoed in the response
+} DaemonHeader;
+
+typedef struct {
+    uint32_t program;
+} DaemonRegistered;
+
+typedef struct {
+    uint32_t program;
+    uint32_t input_length;
+    uint64_t budget;            // instructions, 0 = the daemon's default
+} DaemonRun;
+
+typedef struct {
+    uint64_t instructions;
+    uint64_t cycles;
+    uint16_t pc;
+    uint16_t sp;
+    uint8_t flags;
+    uint8_t halted;             // 0: the budget ran out
+    uint8_t stop;               // CpuStop
+    uint8_t register_count;     // 0 means 256
+    uint32_t output_length;
+    uint32_t reserved;
+} DaemonResult;
+
+#endif //DAEMON_PROTOCOL_H
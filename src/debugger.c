@@ -0,0 +1,304 @@
+#include "debugger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// BREAKPOINTS
+static Breakpoint* find_breakpoint(Debugger* dbg, uint16_t address) {
+    for (size_t i = 0; i < dbg->breakpoint_count; i++) {
+        if (dbg->breakpoints[i].address == address) return &dbg->breakpoints[i];
+    }
+    return NULL;
+}
+
+bool debugger_add_breakpoint(Debugger* dbg, uint16_t address) {
+    if (find_breakpoint(dbg, address)) return true;
+    if (dbg->breakpoint_count == DEBUGGER_MAX_BREAKPOINTS) return false;
+
+    Breakpoint* bp = &dbg->breakpoints[dbg->breakpoint_count++];
+    bp->address = address;
+    bp->original = ram_read(dbg->ram, address);
+
+    if (!dbg->trace) ram_write(dbg->ram, address, BRK);
+    return true;
+}
+
+bool debugger_remove_breakpoint(Debugger* dbg, uint16_t address) {
+    Breakpoint* bp = find_breakpoint(dbg, address);
+    if (!bp) return false;
+
+    if (!dbg->trace) ram_write(dbg->ram, address, bp->original);
+    *bp = dbg->breakpoints[--dbg->breakpoint_count];
+    return true;
+}
+
+uint8_t debugger_peek(Debugger* dbg, uint16_t address) {
+    Breakpoint* bp = dbg->trace ? NULL : find_breakpoint(dbg, address);
+    return bp ? bp->original : ram_read(dbg->ram, address);
+}
+
+// WATCHPOINTS
+static void update_watch_pages(Debugger* dbg) {
+    memset(dbg->bus.pages, 0, sizeof(dbg->bus.pages));
+    for (size_t i = 0; i < dbg->watchpoint_count; i++) {
+        dbg->bus.pages[dbg->watchpoints[i].address >> BUS_PAGE_SHIFT] |= dbg->watchpoints[i].kind;
+    }
+}
+
+// bus trap, only reached for accesses to pages with a watchpoint
+static void watch_trap(void* ctx, uint16_t address, uint8_t value, bool write) {
+    Debugger* dbg = ctx;
+
+    for (size_t i = 0; i < dbg->watchpoint_count; i++) {
+        Watchpoint* wp = &dbg->watchpoints[i];
+        if (wp->address != address) continue;
+        if (!(wp->kind & (write ? BUS_TRAP_WRITE : BUS_TRAP_READ))) continue;
+
+        dbg->hit_address = address;
+        dbg->hit_old = ram_read(dbg->ram, address);
+        dbg->hit_new = value;
+        dbg->hit_write = write;
+
+        // the current instruction still completes
+        dbg->cpu->halted = true;
+        dbg->cpu->stop = STOP_WATCHPOINT;
+        return;
+    }
+}
+
+bool debugger_add_watchpoint(Debugger* dbg, uint16_t address, uint8_t kind) {
+    for (size_t i = 0; i < dbg->watchpoint_count; i++) {
+        if (dbg->watchpoints[i].address == address) {
+            dbg->watchpoints[i].kind = kind;
+            update_watch_pages(dbg);
+            return true;
+        }
+    }
+    if (dbg->watchpoint_count == DEBUGGER_MAX_WATCHPOINTS) return false;
+
+    dbg->watchpoints[dbg->watchpoint_count++] = (Watchpoint){ address, kind };
+    update_watch_pages(dbg);
+    return true;
+}
+
+bool debugger_remove_watchpoint(Debugger* dbg, uint16_t address) {
+    for (size_t i = 0; i < dbg->watchpoint_count; i++) {
+        if (dbg->watchpoints[i].address == address) {
+            dbg->watchpoints[i] = dbg->watchpoints[--dbg->watchpoint_count];
+            update_watch_pages(dbg);
+            return true;
+        }
+    }
+    return false;
+}
+
+// EXECUTION
+void debugger_init(Debugger* dbg, CPU* cpu, RAM* ram) {
+    memset(dbg, 0, sizeof(Debugger));
+    dbg->cpu = cpu;
+    dbg->ram = ram;
+    bus_init(&dbg->bus, ram);
+    bus_set_trap(&dbg->bus, watch_trap, dbg);
+}
+
+void debugger_init_replay(Debugger* dbg, Trace* trace) {
+    debugger_init(dbg, &trace->cpu, trace->ram);
+    dbg->trace = trace;
+}
+
+// clears a breakpoint or watchpoint stop so the CPU can go on
+static void resume(Debugger* dbg) {
+    CPU* cpu = dbg->cpu;
+
+    if (cpu->halted && (cpu->stop == STOP_BREAKPOINT || cpu->stop == STOP_WATCHPOINT)) {
+        cpu->halted = false;
+        cpu->stop = STOP_NONE;
+    }
+}
+
+// executes the instruction under a breakpoint with its original opcode
+static void step_live(Debugger* dbg) {
+    CPU* cpu = dbg->cpu;
+    Breakpoint* bp = find_breakpoint(dbg, cpu->PC);
+
+    if (bp) ram_write(dbg->ram, bp->address, bp->original);
+    cpu_step_bus(cpu, &dbg->bus);
+    if (bp) ram_write(dbg->ram, bp->address, BRK);
+}
+
+static bool at_breakpoint(Debugger* dbg) {
+    return find_breakpoint(dbg, dbg->cpu->PC) != NULL;
+}
+
+void debugger_step(Debugger* dbg) {
+    resume(dbg);
+
+    if (dbg->trace) replay_step(dbg->trace);
+    else step_live(dbg);
+}
+
+void debugger_continue(Debugger* dbg) {
+    CPU* cpu = dbg->cpu;
+
+    resume(dbg);
+
+    if (dbg->trace) {
+        Trace* trace = dbg->trace;
+        do {
+            replay_step(trace);
+        } while (trace->icount < trace->end && !cpu->halted && !at_breakpoint(dbg));
+
+        if (at_breakpoint(dbg)) {
+            cpu->halted = true;
+            cpu->stop = STOP_BREAKPOINT;
+        }
+        return;
+    }
+
+    // step off the breakpoint we are standing on, then run until the next stop
+    if (at_breakpoint(dbg)) {
+        step_live(dbg);
+        if (cpu->halted) return;
+    }
+    cpu_run_bus(cpu, &dbg->bus, UINT64_MAX);
+}
+
+// FRONT END
+static const char* stop_reason(uint8_t stop) {
+    switch (stop) {
+        case STOP_HALT:         return "halted";
+        case STOP_ILLEGAL:      return "illegal instruction";
+        case STOP_BREAKPOINT:   return "breakpoint";
+        case STOP_WATCHPOINT:   return "watchpoint";
+        default:                return "stopped";
+    }
+}
+
+static void print_stop(Debugger* dbg) {
+    CPU* cpu = dbg->cpu;
+
+    if (cpu->halted) {
+        printf("%s at 0x%04x", stop_reason(cpu->stop), cpu->PC);
+        if (cpu->stop == STOP_WATCHPOINT) {
+            if (dbg->hit_write) {
+                printf(": write 0x%04x 0x%02x -> 0x%02x", dbg->hit_address, dbg->hit_old, dbg->hit_new);
+            } else {
+                printf(": read 0x%04x = 0x%02x", dbg->hit_address, dbg->hit_old);
+            }
+        }
+        printf("\n");
+    }
+    if (dbg->trace) printf("instruction %llu\n", (unsigned long long)dbg->trace->icount);
+    print_state(cpu);
+}
+
+static void dump_memory(Debugger* dbg, uint16_t address, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        uint16_t at = (uint16_t)(address + i);
+        if (i % 16 == 0) printf("%s0x%04x:", i ? "\n" : "", at);
+        printf(" %02x", debugger_peek(dbg, at));
+    }
+    printf("\n");
+}
+
+static void list_points(Debugger* dbg) {
+    for (size_t i = 0; i < dbg->breakpoint_count; i++) {
+        printf("breakpoint 0x%04x\n", dbg->breakpoints[i].address);
+    }
+    for (size_t i = 0; i < dbg->watchpoint_count; i++) {
+        uint8_t kind = dbg->watchpoints[i].kind;
+        printf("watchpoint 0x%04x %s%s\n", dbg->watchpoints[i].address,
+            kind & BUS_TRAP_READ ? "r" : "", kind & BUS_TRAP_WRITE ? "w" : "");
+    }
+}
+
+static void print_help(void) {
+    printf(
+        "b <addr>          set breakpoint        d <addr>   delete breakpoint\n"
+        "w <addr> [r|w|rw] set watchpoint        u <addr>   delete watchpoint\n"
+        "s [n]             step                  c          continue\n"
+        "rs                reverse step          rc         reverse continue (replay)\n"
+        "g <n>             go to instruction n (replay)\n"
+        "r                 registers             x <addr> [n]  dump memory\n"
+        "l                 list break/watchpoints  q        quit\n");
+}
+
+static bool parse_number(const char* text, unsigned long* value) {
+    char* end;
+    if (!text) return false;
+    *value = strtoul(text, &end, 0);
+    return *end == '\0';
+}
+
+void debugger_repl(Debugger* dbg, FILE* in) {
+    char line[256];
+
+    print_stop(dbg);
+    for (;;) {
+        printf("(edb) ");
+        fflush(stdout);
+        if (!fgets(line, sizeof(line), in)) break;
+
+        char* command = strtok(line, " \t\r\n");
+        char* arg1 = strtok(NULL, " \t\r\n");
+        char* arg2 = strtok(NULL, " \t\r\n");
+        unsigned long value;
+
+        if (!command) continue;
+
+        if (strcmp(command, "q") == 0) {
+            break;
+        } else if (strcmp(command, "h") == 0) {
+            print_help();
+        } else if (strcmp(command, "b") == 0 && parse_number(arg1, &value)) {
+            if (!debugger_add_breakpoint(dbg, (uint16_t)value)) printf("too many breakpoints\n");
+        } else if (strcmp(command, "d") == 0 && parse_number(arg1, &value)) {
+            if (!debugger_remove_breakpoint(dbg, (uint16_t)value)) printf("no breakpoint there\n");
+        } else if (strcmp(command, "w") == 0 && parse_number(arg1, &value)) {
+            uint8_t kind = BUS_TRAP_WRITE;
+            if (arg2 && strcmp(arg2, "r") == 0) kind = BUS_TRAP_READ;
+            else if (arg2 && strcmp(arg2, "rw") == 0) kind = BUS_TRAP_READ | BUS_TRAP_WRITE;
+            if (dbg->trace) printf("watchpoints need a live CPU\n");
+            else if (!debugger_add_watchpoint(dbg, (uint16_t)value, kind)) printf("too many watchpoints\n");
+        } else if (strcmp(command, "u") == 0 && parse_number(arg1, &value)) {
+            if (!debugger_remove_watchpoint(dbg, (uint16_t)value)) printf("no watchpoint there\n");
+        } else if (strcmp(command, "s") == 0) {
+            unsigned long count = 1;
+            if (arg1 && !parse_number(arg1, &count)) count = 1;
+            for (unsigned long i = 0; i < count; i++) {
+                debugger_step(dbg);
+                if (dbg->cpu->halted) break;
+            }
+            print_stop(dbg);
+        } else if (strcmp(command, "c") == 0) {
+            debugger_continue(dbg);
+            print_stop(dbg);
+        } else if (strcmp(command, "rs") == 0 && dbg->trace) {
+            resume(dbg);
+            replay_step_back(dbg->trace);
+            print_stop(dbg);
+        } else if (strcmp(command, "rc") == 0 && dbg->trace) {
+            resume(dbg);
+            uint16_t addresses[DEBUGGER_MAX_BREAKPOINTS];
+            for (size_t i = 0; i < dbg->breakpoint_count; i++) addresses[i] = dbg->breakpoints[i].address;
+            if (!replay_reverse_continue(dbg->trace, addresses, dbg->breakpoint_count)) {
+                printf("no breakpoint before this point\n");
+            }
+            print_stop(dbg);
+        } else if (strcmp(command, "g") == 0 && dbg->trace && parse_number(arg1, &value)) {
+            resume(dbg);
+            replay_seek(dbg->trace, value);
+            print_stop(dbg);
+        } else if (strcmp(command, "r") == 0) {
+            print_state(dbg->cpu);
+        } else if (strcmp(command, "x") == 0 && parse_number(arg1, &value)) {
+            unsigned long length = 16;
+            if (arg2 && !parse_number(arg2, &length)) length = 16;
+            dump_memory(dbg, (uint16_t)value, length);
+        } else if (strcmp(command, "l") == 0) {
+            list_points(dbg);
+        } else {
+            printf("unknown command, h for help\n");
+        }
+    }
+}
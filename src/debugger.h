@@ -0,0 +1,71 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "cpu.h"
+#include "bus.h"
+#include "replay.h"
+
+// Debugger for a live CPU or a recorded trace.
+//
+// Breakpoints replace the opcode at their address with BRK, the original byte is
+// kept in the breakpoint table. Code without breakpoints runs at full speed, a hit
+// stops the CPU in front of the instruction. The guest sees BRK if it reads its
+// own code at a breakpoint.
+//
+// Watchpoints flag their page in the bus page table, only accesses to these pages
+// leave the fast path. A hit stops the CPU after the accessing instruction.
+//
+// On a trace (replay) breakpoints are checked per instruction instead, since
+// restoring checkpoints would undo the patches.
+
+#define DEBUGGER_MAX_BREAKPOINTS 64
+#define DEBUGGER_MAX_WATCHPOINTS 64
+
+typedef struct {
+    uint16_t address;
+    uint8_t original;       // opcode under the BRK
+} Breakpoint;
+
+typedef struct {
+    uint16_t address;
+    uint8_t kind;           // BUS_TRAP_READ and/or BUS_TRAP_WRITE
+} Watchpoint;
+
+typedef struct {
+    CPU* cpu;
+    RAM* ram;
+    Bus bus;
+    Trace* trace;           // replaying when not NULL
+
+    Breakpoint breakpoints[DEBUGGER_MAX_BREAKPOINTS];
+    size_t breakpoint_count;
+    Watchpoint watchpoints[DEBUGGER_MAX_WATCHPOINTS];
+    size_t watchpoint_count;
+
+    // last watchpoint hit
+    uint16_t hit_address;
+    uint8_t hit_old, hit_new;
+    bool hit_write;
+} Debugger;
+
+void debugger_init(Debugger* dbg, CPU* cpu, RAM* ram);
+void debugger_init_replay(Debugger* dbg, Trace* trace);
+
+bool debugger_add_breakpoint(Debugger* dbg, uint16_t address);
+bool debugger_remove_breakpoint(Debugger* dbg, uint16_t address);
+bool debugger_add_watchpoint(Debugger* dbg, uint16_t address, uint8_t kind);
+bool debugger_remove_watchpoint(Debugger* dbg, uint16_t address);
+
+uint8_t debugger_peek(Debugger* dbg, uint16_t address);    // memory without BRK patches
+
+void debugger_step(Debugger* dbg);
+void debugger_continue(Debugger* dbg);      // until HLT, a breakpoint or a watchpoint
+
+// command line front end, reads commands from `in` until EOF or "q"
+void debugger_repl(Debugger* dbg, FILE* in);
+
+#endif //DEBUGGER_H
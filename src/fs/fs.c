@@ -1,7 +1,7 @@
 #include "fs.h"
 
 // load a binary file into RAM
-void load_program_from_file(RAM* ram, const char* filename) {
+size_t load_program_from_file(RAM* ram, const char* filename) {
     FILE* f = fopen(filename, "rb");
     if (!f) {
         fprintf(stderr, "Error: Could not open program file %s\n", filename);
@@ -13,6 +13,12 @@ void load_program_from_file(RAM* ram, const char* filename) {
     long fsize = ftell(f);
     fseek(f, 0, SEEK_SET);  // back to beginning
 
+    if (fsize > RAM_SIZE) {
+        fprintf(stderr, "Error: Program file %s does not fit into RAM\n", filename);
+        fclose(f);
+        exit(1);
+    }
+
     // read the entire file into a temporary buffer
     unsigned char* buffer = (unsigned char*)malloc(fsize);
     if (!buffer) {
@@ -25,8 +31,10 @@ void load_program_from_file(RAM* ram, const char* filename) {
     fclose(f);
 
     // copy program from buffer to emulator ROM
-    rom_load(ram, buffer, (uint16_t) fsize);
+    rom_load(ram, buffer, (size_t) fsize);
 
     // clean up
     free(buffer);
+
+    return (size_t) fsize;
 }
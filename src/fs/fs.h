@@ -3,4 +3,4 @@
 #include "../ram.h"
 #include "../rom.h"
 
-void load_program_from_file(RAM* ram, const char* filename);
\ No newline at end of file
+size_t load_program_from_file(RAM* ram, const char* filename);   // returns program size
\ No newline at end of file
@@ -0,0 +1,369 @@
+#include "fuzz.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cpu.h"
+#include "bus.h"
+#include "snapshot.h"
+#include "native.h"
+
+// memory the fuzz engine runs on: the bus plus the edge map of this thread
+typedef struct {
+    Bus bus;
+    uint8_t map[FUZZ_MAP_SIZE];
+} FuzzMemory;
+
+static inline void record_edge(FuzzMemory* mem, uint16_t from, uint16_t to) {
+    mem->map[((uint32_t)from * 0x9E3Bu ^ to) & (FUZZ_MAP_SIZE - 1)]++;
+}
+
+// FUZZ ENGINE
+static void fuzz_step(CPU* cpu, FuzzMemory* mem);
+
+#define EXEC_NAME fuzz_step
+#define EXEC_MEMORY FuzzMemory
+#define MEM_READ(mem, addr) bus_read(&(mem)->bus, addr)
+#define MEM_FETCH(mem, addr) bus_fetch(&(mem)->bus, addr)
+#define MEM_WRITE(mem, addr, value) bus_write(&(mem)->bus, addr, value)
+#define MEM_TEST_AND_SET(mem, addr) bus_test_and_set(&(mem)->bus, addr)
+#define MEM_COMPARE_EXCHANGE(mem, addr, expected, desired) bus_compare_exchange(&(mem)->bus, addr, expected, desired)
+#define EXEC_EDGE(mem, from, to) record_edge(mem, from, to)
+#define EXEC_CALL(mem, from, to) record_edge(mem, from, to)
+#define EXEC_RET(mem, from, to) record_edge(mem, from, to)
+#include "cpu_exec.h"
+#undef EXEC_NAME
+#undef EXEC_MEMORY
+#undef MEM_READ
+#undef MEM_FETCH
+#undef MEM_WRITE
+#undef MEM_TEST_AND_SET
+#undef MEM_COMPARE_EXCHANGE
+#undef EXEC_EDGE
+#undef EXEC_CALL
+#undef EXEC_RET
+
+typedef struct {
+    const FuzzConfig* config;
+    const RAM* image;
+
+    uint8_t virgin[FUZZ_MAP_SIZE];          // hit-count buckets not seen yet, per edge
+    uint8_t virgin_crash[FUZZ_MAP_SIZE];    // same, for crashing inputs only
+
+    pthread_mutex_t lock;                   // taken to add to the corpus
+    uint8_t* corpus[FUZZ_MAX_CORPUS];
+    _Atomic size_t corpus_count;
+
+    _Atomic size_t edges;
+    _Atomic uint64_t crashes, unique_crashes, hangs;
+    _Atomic bool stop;
+} FuzzShared;
+
+typedef struct {
+    FuzzShared* shared;
+    size_t index;
+    uint64_t rng;
+    _Atomic uint64_t execs;
+} FuzzWorker;
+
+// AFL style hit-count buckets: 1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+
+static uint8_t buckets[256];
+
+static void init_buckets(void) {
+    for (int count = 0; count < 256; count++) {
+        if (count == 0) buckets[count] = 0;
+        else if (count <= 2) buckets[count] = (uint8_t)count;
+        else if (count == 3) buckets[count] = 4;
+        else if (count <= 7) buckets[count] = 8;
+        else if (count <= 15) buckets[count] = 16;
+        else if (count <= 31) buckets[count] = 32;
+        else if (count <= 127) buckets[count] = 64;
+        else buckets[count] = 128;
+    }
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t next_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+// COVERAGE
+// buckets the hit counts of `map`, clears it and removes the buckets from `virgin`,
+// returns true if any of them had not been seen before
+static bool merge_coverage(FuzzShared* shared, uint8_t* map, uint8_t* virgin, bool count_edges) {
+    bool found = false;
+
+    for (size_t i = 0; i < FUZZ_MAP_SIZE; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, &map[i], sizeof(word));
+        if (!word) continue;
+
+        for (size_t j = i; j < i + sizeof(uint64_t); j++) {
+            uint8_t bits = buckets[map[j]];
+            map[j] = 0;
+            if (!(__atomic_load_n(&virgin[j], __ATOMIC_RELAXED) & bits)) continue;
+
+            uint8_t old = __atomic_fetch_and(&virgin[j], (uint8_t)~bits, __ATOMIC_RELAXED);
+            if (!(old & bits)) continue;    // another thread was first
+
+            found = true;
+            if (count_edges && old == 0xFF) atomic_fetch_add(&shared->edges, 1);
+        }
+    }
+    return found;
+}
+
+// CORPUS
+static void add_to_corpus(FuzzShared* shared, const uint8_t* input) {
+    size_t length = shared->config->input_length;
+
+    pthread_mutex_lock(&shared->lock);
+    size_t count = atomic_load_explicit(&shared->corpus_count, memory_order_relaxed);
+    if (count < FUZZ_MAX_CORPUS) {
+        uint8_t* entry = malloc(length);
+        if (entry) {
+            memcpy(entry, input, length);
+            shared->corpus[count] = entry;
+            atomic_store_explicit(&shared->corpus_count, count + 1, memory_order_release);
+        }
+    }
+    pthread_mutex_unlock(&shared->lock);
+}
+
+// entries are never removed, so they can be read without the lock
+static const uint8_t* pick_from_corpus(FuzzShared* shared, uint64_t* rng) {
+    size_t count = atomic_load_explicit(&shared->corpus_count, memory_order_acquire);
+    return shared->corpus[next_random(rng) % count];
+}
+
+static void save_crash(FuzzShared* shared, const uint8_t* input, uint64_t number, uint16_t pc) {
+    const FuzzConfig* config = shared->config;
+    char path[4096];
+
+    if (!config->out_dir) return;
+
+    snprintf(path, sizeof(path), "%s/crash-%06llu-pc%04x.bin", config->out_dir, (unsigned long long)number, pc);
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "Warning: Could not write %s\n", path);
+        return;
+    }
+    fwrite(input, 1, config->input_length, f);
+    fclose(f);
+}
+
+// MUTATION
+static const uint8_t interesting[] = { 0x00, 0x01, 0x02, 0x10, 0x20, 0x40, 0x7E, 0x7F, 0x80, 0x81, 0xFE, 0xFF };
+
+static void mutate(FuzzShared* shared, uint64_t* rng, uint8_t* input, size_t length) {
+    // splice: head of this input, tail of another one
+    if (next_random(rng) % 8 == 0) {
+        const uint8_t* other = pick_from_corpus(shared, rng);
+        size_t at = next_random(rng) % length;
+        memcpy(&input[at], &other[at], length - at);
+    }
+
+    // havoc: a stack of 2-32 random changes
+    size_t changes = (size_t)2 << (next_random(rng) % 5);
+    for (size_t i = 0; i < changes; i++) {
+        uint64_t r = next_random(rng);
+        size_t at = (size_t)(r >> 8) % length;
+
+        switch (r % 6) {
+            case 0:
+                input[at] ^= (uint8_t)(1 << ((r >> 40) & 7));
+                break;
+            case 1:
+                input[at] = interesting[(r >> 40) % sizeof(interesting)];
+                break;
+            case 2:
+                input[at] += (uint8_t)(1 + (r >> 40) % 35);
+                break;
+            case 3:
+                input[at] -= (uint8_t)(1 + (r >> 40) % 35);
+                break;
+            case 4:
+                input[at] = (uint8_t)(r >> 40);
+                break;
+            case 5: {
+                size_t from = (size_t)(r >> 32) % length;
+                size_t count = 1 + (size_t)(r >> 48) % (length - (at > from ? at : from));
+                memmove(&input[at], &input[from], count);
+                break;
+            }
+        }
+    }
+}
+
+// EXECUTION
+static void* run_worker(void* arg) {
+    FuzzWorker* worker = arg;
+    FuzzShared* shared = worker->shared;
+    const FuzzConfig* config = shared->config;
+    size_t length = config->input_length;
+
+    RAM* ram = ram_alloc(1);
+    FuzzMemory* mem = calloc(1, sizeof(FuzzMemory));
+    uint8_t* input = malloc(length);
+    if (!ram || !mem || !input) {
+        fprintf(stderr, "Error: Could not allocate fuzzer memory\n");
+        exit(1);
+    }
+    memcpy(ram, shared->image, sizeof(RAM));
+
+    Snapshot snapshot;
+    bus_init(&mem->bus, ram);
+    snapshot_init(&snapshot, &mem->bus);
+    snapshot_take(&snapshot);
+
+    // worker 0 starts with the unchanged seed, so its coverage is known
+    bool seed = worker->index == 0;
+
+    CPU cpu;
+    while (!atomic_load_explicit(&shared->stop, memory_order_relaxed)) {
+        memcpy(input, pick_from_corpus(shared, &worker->rng), length);
+        if (!seed) mutate(shared, &worker->rng, input, length);
+
+        snapshot_touch(&snapshot, config->input_address, length);
+        memcpy(&ram->memory[config->input_address], input, length);
+
+        cpu_reset(&cpu);
+        uint64_t executed = 0;
+        while (executed < config->budget && !cpu.halted) {
+            fuzz_step(&cpu, mem);
+            executed++;
+        }
+
+        if (cpu.stop == STOP_ILLEGAL || cpu.stop == STOP_BREAKPOINT) {
+            atomic_fetch_add(&shared->crashes, 1);
+            if (merge_coverage(shared, mem->map, shared->virgin_crash, false)) {
+                uint64_t number = atomic_fetch_add(&shared->unique_crashes, 1) + 1;
+                save_crash(shared, input, number, cpu.PC);
+            }
+        } else {
+            if (!cpu.halted) atomic_fetch_add(&shared->hangs, 1);
+            if (merge_coverage(shared, mem->map, shared->virgin, true) && !seed) {
+                add_to_corpus(shared, input);
+            }
+        }
+
+        snapshot_restore(&snapshot);
+        atomic_fetch_add_explicit(&worker->execs, 1, memory_order_relaxed);
+        seed = false;
+    }
+
+    snapshot_free(&snapshot);
+    ram_free(ram, 1);
+    free(mem);
+    free(input);
+    return NULL;
+}
+
+static uint64_t total_execs(FuzzWorker* workers, size_t count) {
+    uint64_t execs = 0;
+    for (size_t i = 0; i < count; i++) {
+        execs += atomic_load_explicit(&workers[i].execs, memory_order_relaxed);
+    }
+    return execs;
+}
+
+void fuzz_run(const RAM* image, const FuzzConfig* config, FuzzStats* stats) {
+    size_t count = config->threads;
+    if (count == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        count = cpus > 0 ? (size_t)cpus : 1;
+    }
+    if (count > FUZZ_MAX_THREADS) count = FUZZ_MAX_THREADS;
+
+    FuzzShared* shared = calloc(1, sizeof(FuzzShared));
+    FuzzWorker* workers = calloc(count, sizeof(FuzzWorker));
+    pthread_t* threads = calloc(count, sizeof(pthread_t));
+    if (!shared || !workers || !threads) {
+        fprintf(stderr, "Error: Could not allocate fuzzer\n");
+        exit(1);
+    }
+
+    init_buckets();
+    shared->config = config;
+    shared->image = image;
+    memset(shared->virgin, 0xFF, sizeof(shared->virgin));
+    memset(shared->virgin_crash, 0xFF, sizeof(shared->virgin_crash));
+    pthread_mutex_init(&shared->lock, NULL);
+
+    if (config->out_dir && mkdir(config->out_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error: Could not create %s\n", config->out_dir);
+        exit(1);
+    }
+
+    // the input region of the loaded program is the seed
+    add_to_corpus(shared, &image->memory[config->input_address]);
+
+    double start = now_seconds();
+    for (size_t i = 0; i < count; i++) {
+        workers[i].shared = shared;
+        workers[i].index = i;
+        workers[i].rng = (config->seed + i) * 0x9E3779B97F4A7C15ull | 1;
+        pthread_create(&threads[i], NULL, run_worker, &workers[i]);
+    }
+
+    double next_status = start + 1.0;
+    for (;;) {
+        double now = now_seconds();
+        if (now - start >= config->seconds) break;
+
+        if (now >= next_status) {
+            uint64_t execs = total_execs(workers, count);
+            printf("fuzz: %.0fs, %llu execs (%.0f/s), corpus %zu, edges %zu, crashes %llu (%llu unique), hangs %llu\n",
+                now - start, (unsigned long long)execs, (double)execs / (now - start),
+                atomic_load(&shared->corpus_count), atomic_load(&shared->edges),
+                (unsigned long long)atomic_load(&shared->crashes),
+                (unsigned long long)atomic_load(&shared->unique_crashes),
+                (unsigned long long)atomic_load(&shared->hangs));
+            fflush(stdout);
+            next_status += 1.0;
+        }
+
+        struct timespec pause = { 0, 50 * 1000 * 1000 };
+        nanosleep(&pause, NULL);
+    }
+
+    atomic_store(&shared->stop, true);
+    for (size_t i = 0; i < count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    memset(stats, 0, sizeof(FuzzStats));
+    stats->seconds = now_seconds() - start;
+    stats->execs = total_execs(workers, count);
+    stats->threads = count;
+    for (size_t i = 0; i < count; i++) stats->thread_execs[i] = workers[i].execs;
+    stats->crashes = shared->crashes;
+    stats->unique_crashes = shared->unique_crashes;
+    stats->hangs = shared->hangs;
+    stats->corpus = shared->corpus_count;
+    stats->edges = shared->edges;
+
+    for (size_t i = 0; i < shared->corpus_count; i++) free(shared->corpus[i]);
+    pthread_mutex_destroy(&shared->lock);
+    free(threads);
+    free(workers);
+    free(shared);
+}
@@ -0,0 +1,48 @@
+#ifndef FUZZ_H
+#define FUZZ_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ram.h"
+
+// In-process coverage-guided fuzzer.
+//
+// Every execution starts from the loaded program with a mutated input written to a
+// fixed memory region. The fuzz engine counts taken jumps, CALLs and RETs per edge
+// in a small hit-count map; inputs that reach a new edge or a new hit-count bucket
+// go into the corpus shared by all threads. Between executions only the pages the
+// guest wrote are restored (see snapshot.h).
+//
+// An illegal instruction or a BRK is a crash, running out of the instruction budget
+// is a hang.
+
+#define FUZZ_MAP_SIZE           16384       // edge counters, power of two
+#define FUZZ_MAX_THREADS        64
+#define FUZZ_MAX_CORPUS         4096
+#define FUZZ_DEFAULT_BUDGET     100000
+#define FUZZ_DEFAULT_SECONDS    10.0
+
+typedef struct {
+    uint16_t input_address;
+    uint16_t input_length;
+    size_t threads;             // 0 = one per online CPU
+    double seconds;             // wall clock time to fuzz for
+    uint64_t budget;            // instructions per execution
+    const char* out_dir;        // unique crashing inputs are saved here, NULL = not saved
+    uint64_t seed;
+} FuzzConfig;
+
+typedef struct {
+    uint64_t execs;
+    uint64_t crashes, unique_crashes, hangs;
+    size_t corpus;              // inputs in the corpus
+    size_t edges;               // edges seen at least once
+    double seconds;
+    size_t threads;
+    uint64_t thread_execs[FUZZ_MAX_THREADS];
+} FuzzStats;
+
+// prints a status line every second while running
+void fuzz_run(const RAM* image, const FuzzConfig* config, FuzzStats* stats);
+
+#endif //FUZZ_H
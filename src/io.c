@@ -0,0 +1,60 @@
+#include "io.h"
+
+#include <stdio.h>
+
+static uint8_t console_read(void* ctx, uint8_t port) {
+    (void)ctx;
+    if (port != IO_PORT_CONSOLE) return 0;
+
+    int c = getchar();
+    return c == EOF ? 0 : (uint8_t)c;
+}
+
+static void console_write(void* ctx, uint8_t port, uint8_t value) {
+    (void)ctx;
+    if (port == IO_PORT_CONSOLE) putchar(value);
+}
+
+void io_console(IO* io) {
+    io->read = console_read;
+    io->write = console_write;
+    io->ctx = NULL;
+    io->bytes_in = 0;
+    io->bytes_out = 0;
+}
+
+static uint8_t buffer_read(void* ctx, uint8_t port) {
+    IoBuffer* buffer = ctx;
+    if (port != IO_PORT_CONSOLE || buffer->input_position == buffer->input_length) return 0;
+
+    return buffer->input[buffer->input_position++];
+}
+
+static void buffer_write(void* ctx, uint8_t port, uint8_t value) {
+    IoBuffer* buffer = ctx;
+    if (port != IO_PORT_CONSOLE || buffer->output_length == buffer->output_capacity) return;
+
+    buffer->output[buffer->output_length++] = value;
+}
+
+void io_buffer(IO* io, IoBuffer* buffer) {
+    io->read = buffer_read;
+    io->write = buffer_write;
+    io->ctx = buffer;
+    io->bytes_in = 0;
+    io->bytes_out = 0;
+}
+
+uint8_t io_in(IO* io, uint8_t port) {
+    if (!io || !io->read) return 0;
+
+    io->bytes_in++;
+    return io->read(io->ctx, port);
+}
+
+void io_out(IO* io, uint8_t port, uint8_t value) {
+    if (!io || !io->write) return;
+
+    io->bytes_out++;
+    io->write(io->ctx, port, value);
+}
@@ -0,0 +1,37 @@
+#ifndef IO_H
+#define IO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Port I/O, reached through IN <port> and OUT <port>.
+// A CPU without an attached IO reads 0 and drops writes.
+
+#define IO_PORT_CONSOLE 0x00    // stdin / stdout
+
+typedef struct {
+    uint8_t (*read)(void* ctx, uint8_t port);
+    void (*write)(void* ctx, uint8_t port, uint8_t value);
+    void* ctx;
+    uint64_t bytes_in;          // bytes read by the guest
+    uint64_t bytes_out;         // bytes written by the guest
+} IO;
+
+// in-memory console: port 0 reads `input` (0 once it is used up) and appends to `output`,
+// bytes beyond output_capacity are dropped
+typedef struct {
+    const uint8_t* input;
+    size_t input_length;
+    size_t input_position;
+    uint8_t* output;
+    size_t output_length;
+    size_t output_capacity;
+} IoBuffer;
+
+void io_console(IO* io);        // port 0 is stdin/stdout, other ports read 0
+void io_buffer(IO* io, IoBuffer* buffer);
+
+uint8_t io_in(IO* io, uint8_t port);
+void io_out(IO* io, uint8_t port, uint8_t value);
+
+#endif //IO_H
@@ -0,0 +1,41 @@
+#ifndef ISA_H
+#define ISA_H
+
+#include <stdint.h>
+
+// Opcodes and their encoding, generated from isa.def. Plain C, also included from C++.
+
+typedef enum {
+#define ISA(name, opcode, operands, cycles, assembler) name = opcode,
+#include "isa.def"
+#undef ISA
+} Instruction;
+
+typedef enum {
+    OPERANDS_NONE = 0,      // opcode only
+    OPERANDS_IMM8,          // 8-bit value: LDI 5, IN 0
+    OPERANDS_REG,           // register: PUSH A
+    OPERANDS_REG_REG,       // two registers: ADD A, B
+    OPERANDS_ADDR,          // 16-bit address, high byte first: JMP LOOP
+} OperandKind;
+
+// instruction length per operand kind
+#define ISA_LENGTH_NONE     1
+#define ISA_LENGTH_IMM8     2
+#define ISA_LENGTH_REG      2
+#define ISA_LENGTH_REG_REG  3
+#define ISA_LENGTH_ADDR     3
+
+typedef struct {
+    const char* name;       // NULL for undefined opcodes
+    uint8_t length;         // bytes, 0 for undefined opcodes
+    uint8_t operands;       // OperandKind
+    uint8_t cycles;
+    uint8_t assembler;      // accepted by easm
+} OpcodeInfo;
+
+// entry for one opcode, usable in initializers: [opcode] = ISA_INFO(...) in C
+#define ISA_INFO(name, operands, cycles, assembler) \
+    { #name, ISA_LENGTH_##operands, OPERANDS_##operands, cycles, assembler }
+
+#endif //ISA_H
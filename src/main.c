@@ -1,29 +1,704 @@
+#include <errno.h>
+#include <getopt.h>
+#include <string.h>
+#include <time.h>
+
 #include "cpu.h"
+#include "smp.h"
+#include "sched.h"
+#include "replay.h"
+#include "debugger.h"
+#include "memo.h"
+#include "fuzz.h"
+#include "pace.h"
+#include "stats.h"
+#include "profile.h"
+#include "symbols.h"
+#include "native.h"
+#include "arena.h"
+#include "perf.h"
+#include "daemon.h"
 #include "fs/fs.h"
 
+static RAM ram;
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+        "Usage: %s [options] <program.bin>\n"
+        "  --smp <n>              run <n> CPUs sharing one RAM\n"
+        "  --smp-mode <mode>      lockstep (deterministic, default) or free\n"
+        "  --quantum <n>          instructions per lockstep round (default %d)\n"
+        "  --guests <n>           run <n> independent copies of the program\n"
+        "  --threads <n>          host threads for --guests (default 1)\n"
+        "  --slice <n>            instructions per guest time slice (default %d)\n"
+        "  --arena                allocate guests from per-thread huge page slabs, see arena.h\n"
+        "  --record <trace>       record the run for deterministic replay\n"
+        "  --checkpoint-interval <n>  instructions between checkpoints (default %d)\n"
+        "  --replay <trace>       replay a recorded run instead of loading a program\n"
+        "  --goto <n>             replay: show the state after <n> instructions\n"
+        "  --reverse-to <addr>    replay: then run backwards to the last visit of <addr>\n"
+        "  --debug                start the command line debugger (also with --replay)\n"
+        "  --memo                 skip repeated calls of pure subroutines\n"
+        "  --profile <file>       sample the guest call stack, write folded stacks to <file>\n"
+        "  --profile-period <n>   instructions between samples (default %d)\n"
+        "  --profile-hz <hz>      sample on a SIGPROF timer instead, <hz> per CPU second\n"
+        "  --symbols <map>        guest labels for --profile and --native from an easm/eld map file\n"
+        "  --native <name>@<addr|label>[:cycles]  run the routine at <addr> natively, see native.h\n"
+        "  --native-verify        run bound routines both natively and in the guest and compare\n"
+        "  --fuzz <addr>:<len>    fuzz the program with inputs written to <addr>\n"
+        "  --fuzz-threads <n>     fuzzer threads (default: all cores)\n"
+        "  --fuzz-time <s>        seconds to fuzz for (default %.0f)\n"
+        "  --fuzz-budget <n>      instructions per input before it counts as a hang (default %d)\n"
+        "  --fuzz-out <dir>       save unique crashing inputs to <dir>\n"
+        "  --clock <hz>           run in real time at <hz> cycles per second (k, M, G suffixes)\n"
+        "  --batch <cycles>       cycles between sleeps with --clock (default %d us of guest time)\n"
+        "  --stats <name>         publish live statistics to shared memory, see estat\n"
+        "  --stats-interval <n>   instructions between statistics updates (default %d)\n"
+        "  --daemon <socket>      serve jobs on a Unix socket instead of loading a program\n"
+        "  --pool <n>             daemon: pre-initialized CPU/RAM instances (default %d)\n"
+        "  --job-budget <n>       daemon: default instructions per job (default %d)\n",
+        prog, SMP_DEFAULT_QUANTUM, SCHED_DEFAULT_SLICE, REPLAY_DEFAULT_INTERVAL,
+        PROFILE_DEFAULT_PERIOD, FUZZ_DEFAULT_SECONDS, FUZZ_DEFAULT_BUDGET, PACE_DEFAULT_BATCH_US,
+        STATS_DEFAULT_INTERVAL, DAEMON_DEFAULT_POOL, DAEMON_DEFAULT_BUDGET);
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// parses a frequency like 4000, 250k or 1.5M
+static uint64_t parse_hz(const char* text) {
+    char* end;
+    double value = strtod(text, &end);
+
+    if (*end == 'k' || *end == 'K') value *= 1e3;
+    else if (*end == 'M') value *= 1e6;
+    else if (*end == 'G') value *= 1e9;
+    return value > 0 ? (uint64_t)value : 0;
+}
+
+// binds a native to a guest routine, spec is <name>@<address|label>[:cycles]
+static void bind_native(RAM* ram, const char* spec, const SymbolTable* symbols) {
+    char name[64], target[64];
+    unsigned long long cycles = 0;
+    if (sscanf(spec, "%63[^@]@%63[^:]:%llu", name, target, &cycles) < 2) {
+        fprintf(stderr, "Error: Invalid native binding %s\n", spec);
+        exit(1);
+    }
+
+    const NativeRoutine* routine = native_find(name);
+    if (!routine) {
+        fprintf(stderr, "Error: Unknown native %s, available: ", name);
+        native_list(stderr);
+        exit(1);
+    }
+
+    char* end;
+    unsigned long address = strtoul(target, &end, 0);
+    if (*end != '\0') {
+        const Symbol* symbol = symbols ? symbols_find(symbols, target) : NULL;
+        if (!symbol) {
+            fprintf(stderr, "Error: Unknown label %s (pass the map file with --symbols)\n", target);
+            exit(1);
+        }
+        address = symbol->address;
+    }
+    if (address >= RAM_SIZE) {
+        fprintf(stderr, "Error: Could not bind native %s to 0x%04lx\n", name, address);
+        exit(1);
+    }
+    if (!native_bind(ram, routine, (uint16_t)address, cycles)) {
+        fprintf(stderr, "Error: Could not bind native %s to 0x%04lx, the routine has to start "
+            "with an instruction of at least %d bytes\n", name, address, ISA_LENGTH_IMM8);
+        exit(1);
+    }
+}
+
+// runs the SMP guest and compares its throughput to the single CPU interpreter
+static void run_smp(const RAM* image, size_t count, SmpMode mode, uint64_t quantum) {
+    CPU* cpus = calloc(count, sizeof(CPU));
+    if (!cpus) {
+        fprintf(stderr, "Error: Could not allocate %zu CPUs\n", count);
+        exit(1);
+    }
+    static IO console;
+    io_console(&console);
+
+    for (size_t i = 0; i < count; i++) {
+        cpu_reset(&cpus[i]);
+        cpus[i].io = &console;
+    }
+
+    SmpStats stats;
+    smp_run(cpus, count, &ram, mode, quantum, &stats);
+
+    for (size_t i = 0; i < count; i++) {
+        printf("--- CPU %zu\n", i);
+        print_state(&cpus[i]);
+    }
+
+    // baseline: one CPU on a fresh copy of the program, same instruction budget
+    static RAM baseline_ram;
+    memcpy(&baseline_ram, image, sizeof(RAM));
+
+    CPU single;
+    cpu_reset(&single);
+
+    double start = now_seconds();
+    uint64_t single_retired = 0;
+    while (single_retired < stats.retired && !single.halted) {
+        single_retired += cpu_run(&single, &baseline_ram, stats.retired - single_retired);
+    }
+    double single_seconds = now_seconds() - start;
+
+    double smp_mips = stats.seconds > 0 ? (double)stats.retired / stats.seconds / 1e6 : 0;
+    double single_mips = single_seconds > 0 ? (double)single_retired / single_seconds / 1e6 : 0;
+
+    printf("SMP: %zu CPUs (%s), %llu instructions in %.3fs, %.2f MIPS",
+        count, mode == SMP_LOCKSTEP ? "lockstep" : "free running",
+        (unsigned long long)stats.retired, stats.seconds, smp_mips);
+    if (mode == SMP_LOCKSTEP) printf(", %llu rounds", (unsigned long long)stats.rounds);
+    printf("\n");
+    printf("Single CPU: %llu instructions in %.3fs, %.2f MIPS, scaling %.2fx\n",
+        (unsigned long long)single_retired, single_seconds, single_mips,
+        single_mips > 0 ? smp_mips / single_mips : 0);
+
+    free(cpus);
+}
+
+// resident set size of the emulator in bytes
+static size_t resident_bytes(void) {
+    FILE* f = fopen("/proc/self/statm", "r");
+    unsigned long pages = 0, resident = 0;
+
+    if (f) {
+        if (fscanf(f, "%lu %lu", &pages, &resident) != 2) resident = 0;
+        fclose(f);
+    }
+    return (size_t)resident * 4096;
+}
+
+// runs many copies of the program on the green-thread scheduler
+static void run_guests(const RAM* image, size_t program_size, size_t count, size_t threads, uint64_t slice,
+                       bool use_arena) {
+    size_t rss_before = resident_bytes();
+    double setup_start = now_seconds();
+
+    Scheduler sched;
+    sched_init(&sched, threads, slice, count);
+
+    Guest* guests = NULL;
+    RAM* memory = NULL;
+    Guest* last = NULL;
+    static Arena arena;
+    if (use_arena) {
+        if (!arena_init(&arena, sched.threads, count, image, program_size)) {
+            fprintf(stderr, "Error: Could not allocate %zu guests\n", count);
+            exit(1);
+        }
+        // workers run on the CPUs that touched their slabs first
+        sched.pin = true;
+        for (size_t w = 0; w < sched.threads; w++) {
+            for (size_t i = 0; i < arena.slabs[w].count; i++) {
+                last = &arena.slabs[w].guests[i];
+                sched_wake_on(&sched, last, w);
+            }
+        }
+    } else {
+        guests = aligned_alloc(_Alignof(Guest), count * sizeof(Guest));
+        memory = ram_alloc(count);
+        if (!guests || !memory) {
+            fprintf(stderr, "Error: Could not allocate %zu guests\n", count);
+            exit(1);
+        }
+        memset(guests, 0, count * sizeof(Guest));
+
+        for (size_t i = 0; i < count; i++) {
+            guests[i].ram = &memory[i];
+            guests[i].index = (uint32_t)i;
+            cpu_reset(&guests[i].cpu);
+            rom_load(guests[i].ram, image->memory, program_size);
+            sched_wake(&sched, &guests[i]);
+        }
+        last = &guests[count - 1];
+    }
+    double setup_seconds = now_seconds() - setup_start;
+
+    Perf perf;
+    perf_start(&perf);
+    SchedStats stats;
+    sched_run(&sched, &stats);
+    uint64_t tlb_misses[PERF_COUNTERS];
+    bool tlb_counted[PERF_COUNTERS];
+    for (int i = 0; i < PERF_COUNTERS; i++) tlb_counted[i] = perf_stop(&perf, (PerfEvent)i, &tlb_misses[i]);
+    perf_close(&perf);
+    size_t rss_after = resident_bytes();
+
+    print_state(&last->cpu);
+
+    double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+    printf("Guests: %zu on %zu threads, %llu instructions in %.3fs, %.2f MIPS\n",
+        count, sched.threads, (unsigned long long)stats.retired, stats.seconds,
+        (double)stats.retired / seconds / 1e6);
+    printf("Slices: %llu (%llu stolen), %.1f ns per slice, %.1f instructions per slice\n",
+        (unsigned long long)stats.slices, (unsigned long long)stats.steals,
+        stats.slices ? seconds * 1e9 * (double)sched.threads / (double)stats.slices : 0,
+        stats.slices ? (double)stats.retired / (double)stats.slices : 0);
+    printf("Memory: %zu bytes context + %zu bytes resident per guest, set up in %.3fs (%s)\n",
+        sizeof(Guest), rss_after > rss_before ? (rss_after - rss_before) / count : 0, setup_seconds,
+        !use_arena ? "ram_alloc" : arena.hugetlb ? "arena, hugetlb pages" : "arena, transparent huge pages");
+    printf("TLB:");
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        if (tlb_counted[i]) {
+            printf(" %llu %s (%.3f per 1k instructions)", (unsigned long long)tlb_misses[i],
+                perf_event_name((PerfEvent)i),
+                stats.retired ? (double)tlb_misses[i] * 1000.0 / (double)stats.retired : 0);
+        } else {
+            printf(" %s unavailable", perf_event_name((PerfEvent)i));
+        }
+        printf(i + 1 < PERF_COUNTERS ? "," : "");
+    }
+    if (perf.error) printf(" (%s)", strerror(perf.error));
+    printf("\n");
+
+    sched_destroy(&sched);
+    if (use_arena) arena_free(&arena);
+    ram_free(memory, count);
+    free(guests);
+}
+
+// replays a recorded trace, optionally going backwards from there
+static void run_replay(const char* trace_file, uint64_t target, bool reverse, uint16_t breakpoint, bool debug) {
+    Trace trace;
+    if (!trace_load(&trace, trace_file)) {
+        fprintf(stderr, "Error: Could not read trace %s\n", trace_file);
+        exit(1);
+    }
+    printf("Trace: %llu instructions, %zu checkpoints, %zu input bytes\n",
+        (unsigned long long)trace.end, trace.checkpoint_count, trace.input_count);
+
+    replay_seek(&trace, target);
+    if (reverse) {
+        if (!replay_reverse_continue(&trace, &breakpoint, 1)) {
+            printf("0x%04x was not reached before instruction %llu\n",
+                breakpoint, (unsigned long long)target);
+        }
+    }
+
+    if (debug) {
+        Debugger dbg;
+        debugger_init_replay(&dbg, &trace);
+        debugger_repl(&dbg, stdin);
+    } else {
+        printf("--- after %llu instructions\n", (unsigned long long)trace.icount);
+        print_state(&trace.cpu);
+    }
+    trace_free(&trace);
+}
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <program.bin>\n", argv[0]);
+    size_t smp_cpus = 0;
+    SmpMode smp_mode = SMP_LOCKSTEP;
+    uint64_t quantum = SMP_DEFAULT_QUANTUM;
+    size_t guests = 0;
+    size_t threads = 1;
+    uint64_t slice = SCHED_DEFAULT_SLICE;
+    bool use_arena = false;
+    const char* record_file = NULL;
+    const char* replay_file = NULL;
+    uint64_t checkpoint_interval = REPLAY_DEFAULT_INTERVAL;
+    uint64_t replay_target = UINT64_MAX;
+    bool reverse = false;
+    uint16_t reverse_address = 0;
+    bool debug = false;
+    bool memoize = false;
+    const char* profile_file = NULL;
+    uint64_t profile_period = 0;
+    uint64_t profile_hz = 0;
+    const char* symbols_file = NULL;
+    const char* native_specs[NATIVE_MAX_BINDINGS];
+    size_t native_count = 0;
+    bool native_verify = false;
+    bool fuzz = false;
+    FuzzConfig fuzz_config = {
+        .threads = 0,
+        .seconds = FUZZ_DEFAULT_SECONDS,
+        .budget = FUZZ_DEFAULT_BUDGET,
+    };
+    uint64_t clock_hz = 0;
+    uint64_t batch = 0;
+    const char* stats_name = NULL;
+    uint64_t stats_interval = STATS_DEFAULT_INTERVAL;
+    const char* daemon_socket = NULL;
+    size_t pool = DAEMON_DEFAULT_POOL;
+    uint64_t job_budget = DAEMON_DEFAULT_BUDGET;
+
+    static const struct option options[] = {
+        {"smp",      required_argument, NULL, 's'},
+        {"smp-mode", required_argument, NULL, 'm'},
+        {"quantum",  required_argument, NULL, 'q'},
+        {"guests",   required_argument, NULL, 'g'},
+        {"threads",  required_argument, NULL, 't'},
+        {"slice",    required_argument, NULL, 'l'},
+        {"arena",    no_argument,       NULL, 'a'},
+        {"record",   required_argument, NULL, 'r'},
+        {"checkpoint-interval", required_argument, NULL, 'i'},
+        {"replay",   required_argument, NULL, 'p'},
+        {"goto",     required_argument, NULL, 'o'},
+        {"reverse-to", required_argument, NULL, 'b'},
+        {"debug",    no_argument,       NULL, 'd'},
+        {"memo",     no_argument,       NULL, 'M'},
+        {"profile",  required_argument, NULL, 'F'},
+        {"profile-period", required_argument, NULL, 'E'},
+        {"profile-hz", required_argument, NULL, 'H'},
+        {"symbols",  required_argument, NULL, 'Y'},
+        {"native",   required_argument, NULL, 'N'},
+        {"native-verify", no_argument,  NULL, 'V'},
+        {"fuzz",     required_argument, NULL, 'f'},
+        {"fuzz-threads", required_argument, NULL, 'T'},
+        {"fuzz-time", required_argument, NULL, 'S'},
+        {"fuzz-budget", required_argument, NULL, 'B'},
+        {"fuzz-out", required_argument, NULL, 'O'},
+        {"clock",    required_argument, NULL, 'c'},
+        {"batch",    required_argument, NULL, 'n'},
+        {"stats",    required_argument, NULL, 'x'},
+        {"stats-interval", required_argument, NULL, 'X'},
+        {"daemon",   required_argument, NULL, 'D'},
+        {"pool",     required_argument, NULL, 'P'},
+        {"job-budget", required_argument, NULL, 'J'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                smp_cpus = strtoul(optarg, NULL, 0);
+                break;
+            case 'm':
+                if (strcmp(optarg, "lockstep") == 0) smp_mode = SMP_LOCKSTEP;
+                else if (strcmp(optarg, "free") == 0) smp_mode = SMP_FREE_RUNNING;
+                else {
+                    usage(argv[0]);
+                    exit(1);
+                }
+                break;
+            case 'q':
+                quantum = strtoull(optarg, NULL, 0);
+                break;
+            case 'g':
+                guests = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                threads = strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                slice = strtoull(optarg, NULL, 0);
+                break;
+            case 'a':
+                use_arena = true;
+                break;
+            case 'r':
+                record_file = optarg;
+                break;
+            case 'i':
+                checkpoint_interval = strtoull(optarg, NULL, 0);
+                break;
+            case 'p':
+                replay_file = optarg;
+                break;
+            case 'o':
+                replay_target = strtoull(optarg, NULL, 0);
+                break;
+            case 'b':
+                reverse = true;
+                reverse_address = (uint16_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'd':
+                debug = true;
+                break;
+            case 'M':
+                memoize = true;
+                break;
+            case 'F':
+                profile_file = optarg;
+                break;
+            case 'E':
+                profile_period = strtoull(optarg, NULL, 0);
+                break;
+            case 'H':
+                profile_hz = parse_hz(optarg);
+                break;
+            case 'Y':
+                symbols_file = optarg;
+                break;
+            case 'N':
+                if (native_count == NATIVE_MAX_BINDINGS) {
+                    fprintf(stderr, "Error: Too many native bindings\n");
+                    exit(1);
+                }
+                native_specs[native_count++] = optarg;
+                break;
+            case 'V':
+                native_verify = true;
+                break;
+            case 'f': {
+                char* end;
+                unsigned long address = strtoul(optarg, &end, 0);
+                unsigned long length = *end == ':' ? strtoul(end + 1, NULL, 0) : 0;
+                // the region is at most 0xFFFF bytes, FuzzConfig.input_length is 16 bits
+                if (length == 0 || length > UINT16_MAX || address + length > RAM_SIZE) {
+                    fprintf(stderr, "Error: Invalid fuzz input region %s\n", optarg);
+                    exit(1);
+                }
+                fuzz = true;
+                fuzz_config.input_address = (uint16_t)address;
+                fuzz_config.input_length = (uint16_t)length;
+                break;
+            }
+            case 'T':
+                fuzz_config.threads = strtoul(optarg, NULL, 0);
+                break;
+            case 'S':
+                fuzz_config.seconds = strtod(optarg, NULL);
+                break;
+            case 'B':
+                fuzz_config.budget = strtoull(optarg, NULL, 0);
+                break;
+            case 'O':
+                fuzz_config.out_dir = optarg;
+                break;
+            case 'c':
+                clock_hz = parse_hz(optarg);
+                if (clock_hz == 0) {
+                    fprintf(stderr, "Error: Invalid clock %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'n':
+                batch = strtoull(optarg, NULL, 0);
+                break;
+            case 'x':
+                stats_name = optarg;
+                break;
+            case 'X':
+                stats_interval = strtoull(optarg, NULL, 0);
+                break;
+            case 'D':
+                daemon_socket = optarg;
+                break;
+            case 'P':
+                pool = strtoul(optarg, NULL, 0);
+                break;
+            case 'J':
+                job_budget = strtoull(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+                exit(1);
+        }
+    }
+
+    // statistics describe one CPU running a program to its end
+    if (stats_name && (daemon_socket || replay_file || smp_cpus || guests || fuzz || debug ||
+            native_verify || memoize || profile_file || record_file)) {
+        fprintf(stderr, "Error: --stats only works with a plain or --clock run\n");
         exit(1);
     }
 
-    const char* file_name = argv[1];
+    if (daemon_socket && optind == argc) {
+        daemon_run(daemon_socket, pool, job_budget);
+        return 0;
+    }
+
+    if (replay_file && optind == argc) {
+        run_replay(replay_file, replay_target == UINT64_MAX && debug ? 0 : replay_target,
+            reverse, reverse_address, debug);
+        return 0;
+    }
+
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        exit(1);
+    }
+
+    const char* file_name = argv[optind];
 
     CPU cpu;
-    RAM ram;
+    IO console;
 
     cpu_reset(&cpu);
     ram_init(&ram);
+    io_console(&console);
+    cpu.io = &console;
 
     printf("Loading \"%s\" into memory...\n", file_name);
-    load_program_from_file(&ram, file_name);
+    size_t program_size = load_program_from_file(&ram, file_name);
+
+    uint16_t bad_address;
+    if (!cpu_validate_program(&ram, 0x0000, program_size, &bad_address)) {
+        fprintf(stderr, "Error: Invalid register operand at 0x%04x (CPU has %d registers)\n",
+            bad_address, CPU_NUM_REGISTERS);
+        exit(1);
+    }
+
+    static SymbolTable symbols;
+    if (symbols_file && !symbols_load(&symbols, symbols_file)) {
+        fprintf(stderr, "Error: Could not read symbols %s\n", symbols_file);
+        exit(1);
+    }
+    for (size_t i = 0; i < native_count; i++) {
+        bind_native(&ram, native_specs[i], &symbols);
+    }
     printf("Load complete. Starting CPU...\n");
 
+    if (smp_cpus > 0) {
+        static RAM image;
+        memcpy(&image, &ram, sizeof(RAM));
+        run_smp(&image, smp_cpus, smp_mode, quantum);
+        return 0;
+    }
+
+    if (guests > 0) {
+        run_guests(&ram, program_size, guests, threads, slice, use_arena);
+        return 0;
+    }
+
+    if (fuzz) {
+        FuzzStats stats;
+        fuzz_config.seed = (uint64_t)time(NULL);
+        fuzz_run(&ram, &fuzz_config, &stats);
+
+        double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+        printf("Fuzz: %llu execs in %.1fs, %.0f execs/s on %zu threads, corpus %zu, edges %zu\n",
+            (unsigned long long)stats.execs, stats.seconds, (double)stats.execs / seconds,
+            stats.threads, stats.corpus, stats.edges);
+        for (size_t i = 0; i < stats.threads; i++) {
+            printf("  thread %zu: %.0f execs/s\n", i, (double)stats.thread_execs[i] / seconds);
+        }
+        printf("Crashes: %llu (%llu unique), hangs: %llu\n",
+            (unsigned long long)stats.crashes, (unsigned long long)stats.unique_crashes,
+            (unsigned long long)stats.hangs);
+        return 0;
+    }
+
+    if (debug) {
+        Debugger dbg;
+        debugger_init(&dbg, &cpu, &ram);
+        debugger_repl(&dbg, stdin);
+        return 0;
+    }
+
+    if (native_verify) {
+        uint64_t retired = native_verify_run(&cpu, &ram, UINT64_MAX);
+
+        print_state(&cpu);
+        printf("Native verify: %llu instructions\n", (unsigned long long)retired);
+        for (size_t i = 0; i < native_binding_count; i++) {
+            const NativeBinding* binding = &native_bindings[i];
+            printf("  %s at 0x%04x: %llu calls, %llu mismatches, guest %.1f cycles per call, native charges %llu\n",
+                binding->routine->name, binding->address, (unsigned long long)binding->calls,
+                (unsigned long long)binding->mismatches,
+                binding->calls ? (double)binding->guest_cycles / (double)binding->calls : 0,
+                (unsigned long long)binding->cycles);
+        }
+        return 0;
+    }
+
+    if (memoize) {
+        static Memo memo;
+        memo_init(&memo, &ram);
+        uint64_t retired = memo_run(&memo, &cpu, UINT64_MAX);
+
+        print_state(&cpu);
+        printf("Memo: %llu instructions, %llu skipped, %llu calls, %llu hits, %llu misses, "
+            "%zu pure routines, %llu invalidations\n",
+            (unsigned long long)retired, (unsigned long long)memo.skipped,
+            (unsigned long long)memo.calls, (unsigned long long)memo.hits,
+            (unsigned long long)memo.misses, memo_pure_routines(&memo),
+            (unsigned long long)memo.invalidations);
+        memo_free(&memo);
+        return 0;
+    }
+
+    if (profile_file) {
+        FILE* out = fopen(profile_file, "w");
+        if (!out) {
+            fprintf(stderr, "Error: Could not write profile %s\n", profile_file);
+            exit(1);
+        }
+
+        static Profiler profiler;
+        profile_init(&profiler, &ram, profile_period, profile_period ? 0 : profile_hz);
+        profiler.symbols = &symbols;
+
+        double start = now_seconds();
+        uint64_t retired = profile_run(&profiler, &cpu, UINT64_MAX);
+        double seconds = now_seconds() - start;
+
+        profile_write_folded(&profiler, out);
+        fclose(out);
+
+        print_state(&cpu);
+        printf("Profile: %llu instructions in %.3fs, %llu samples, %zu stacks (%llu dropped, "
+            "%llu unmatched RETs) written to %s\n",
+            (unsigned long long)retired, seconds, (unsigned long long)profiler.samples,
+            profiler.stack_count, (unsigned long long)profiler.dropped,
+            (unsigned long long)profiler.unmatched, profile_file);
+        profile_free(&profiler);
+        return 0;
+    }
+
+    if (record_file) {
+        Trace trace;
+        trace_init(&trace, checkpoint_interval);
+        trace_record(&trace, &cpu, &ram, &console, UINT64_MAX);
+
+        if (!trace_save(&trace, record_file)) {
+            fprintf(stderr, "Error: Could not write trace %s\n", record_file);
+            exit(1);
+        }
+        printf("Recorded %llu instructions, %zu checkpoints, %zu input bytes to %s\n",
+            (unsigned long long)trace.end, trace.checkpoint_count, trace.input_count, record_file);
+        trace_free(&trace);
+    }
+
+    Stats live;
+    if (stats_name && !stats_open(&live, stats_name, file_name, stats_interval)) {
+        fprintf(stderr, "Error: Could not create statistics segment %s (%s)\n", stats_name,
+            errno == EEXIST ? "in use by a running emulator" : strerror(errno));
+        exit(1);
+    }
+
+    if (clock_hz > 0) {
+        if (batch == 0) batch = clock_hz * PACE_DEFAULT_BATCH_US / 1000000 + 1;
+
+        PaceStats stats;
+        pace_run(&cpu, &ram, clock_hz, batch, stats_name ? &live : NULL, &stats);
+        if (stats_name) stats_close(&live);
+
+        print_state(&cpu);
+        printf("Pace: %llu cycles, %llu instructions in %.3fs at %llu Hz, %llu batches (%llu late)\n",
+            (unsigned long long)stats.cycles, (unsigned long long)stats.instructions, stats.seconds,
+            (unsigned long long)clock_hz, (unsigned long long)stats.batches, (unsigned long long)stats.late);
+        printf("Drift: %+.3f ms, wakeup jitter mean %.1f us, stddev %.1f us, max %.1f us\n",
+            stats.drift * 1e3, stats.jitter_mean * 1e6, stats.jitter_stddev * 1e6, stats.jitter_max * 1e6);
+        printf("Host CPU: %.3fs (%.1f%%)\n", stats.cpu_seconds,
+            stats.seconds > 0 ? stats.cpu_seconds / stats.seconds * 100 : 0);
+        return 0;
+    }
+
+    if (stats_name) {
+        stats_run(&live, &cpu, &ram, UINT64_MAX);
+        stats_close(&live);
+    }
+
     while (!cpu.halted) {
         cpu_step(&cpu, &ram);
     }
 
     print_state(&cpu);
     return 0;
-}
\ No newline at end of file
+}
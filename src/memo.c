@@ -0,0 +1,447 @@
+#include "memo.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REG_BIT(r)      (1ull << (r))
+#define FLAGS_BIT       (1ull << MEMO_FLAGS_BIT)
+#define ALL_BITS        (FLAGS_BIT | (REG_BIT(CPU_NUM_REGISTERS < MEMO_FLAGS_BIT ? CPU_NUM_REGISTERS : MEMO_FLAGS_BIT) - 1))
+#define MAX_FIXPOINT    8
+
+// ANALYSIS
+typedef struct {
+    uint16_t pc;
+    uint8_t opcode;
+    uint8_t length;
+    int16_t depth;          // bytes this routine pushed before the instruction
+    uint64_t uses, must, may;
+    uint64_t in;            // registers written on every path to the instruction
+    uint16_t successors[2];
+    uint8_t successor_count;
+} Node;
+
+typedef struct {
+    Node nodes[MEMO_MAX_LENGTH];
+    size_t count;
+} Graph;
+
+static MemoRoutine* analyse(Memo* memo, uint16_t entry);
+
+static bool register_bit(uint8_t r, uint64_t* bit) {
+    if (r >= CPU_NUM_REGISTERS || r >= MEMO_FLAGS_BIT) return false;
+    *bit = REG_BIT(r);
+    return true;
+}
+
+static int find_node(const Graph* graph, uint16_t pc) {
+    for (size_t i = 0; i < graph->count; i++) {
+        if (graph->nodes[i].pc == pc) return (int)i;
+    }
+    return -1;
+}
+
+// fills in length, successors and register effects, false if the instruction is impure
+static bool decode(Memo* memo, MemoRoutine* routine, Node* node) {
+    RAM* ram = memo->ram;
+    uint16_t pc = node->pc;
+    uint8_t op1 = ram_read(ram, (uint16_t)(pc + 1));
+    uint8_t op2 = ram_read(ram, (uint16_t)(pc + 2));
+    uint16_t target = (uint16_t)(op1 << 8 | op2);
+    uint64_t r1 = 0, r2 = 0;
+
+    node->opcode = ram_read(ram, pc);
+    node->length = cpu_opcodes[node->opcode].length;
+    node->uses = node->must = node->may = 0;
+    node->successor_count = 0;
+
+    switch (node->opcode) {
+        case NOP:
+            break;
+
+        case LDI:               // only Z is written, the other flags pass through
+            node->uses = FLAGS_BIT;
+            node->must = REG_BIT(A) | FLAGS_BIT;
+            break;
+
+        case INC: case DEC:     // carry passes through
+            node->uses = REG_BIT(A) | FLAGS_BIT;
+            node->must = REG_BIT(A) | FLAGS_BIT;
+            break;
+
+        case ADD: case SUB: case MUL: case AND: case OR: case XOR:
+            if (!register_bit(op1, &r1) || !register_bit(op2, &r2)) return false;
+            node->uses = r1 | r2;
+            node->must = r1 | FLAGS_BIT;
+            break;
+
+        case ADC: case SBB:     // carry in
+            if (!register_bit(op1, &r1) || !register_bit(op2, &r2)) return false;
+            node->uses = r1 | r2 | FLAGS_BIT;
+            node->must = r1 | FLAGS_BIT;
+            break;
+
+        case SHL: case SHR:
+            if (!register_bit(op1, &r1)) return false;
+            node->uses = r1;
+            node->must = r1 | FLAGS_BIT;
+            break;
+
+        case RCL: case RCR:     // carry in
+            if (!register_bit(op1, &r1)) return false;
+            node->uses = r1 | FLAGS_BIT;
+            node->must = r1 | FLAGS_BIT;
+            break;
+
+        case MOV:
+            if (!register_bit(op1, &r1) || !register_bit(op2, &r2)) return false;
+            node->uses = r2;
+            node->must = r1;
+            break;
+
+        case CMP:
+            if (!register_bit(op1, &r1) || !register_bit(op2, &r2)) return false;
+            node->uses = r1 | r2;
+            node->must = FLAGS_BIT;
+            break;
+
+        case NOT:
+            if (!register_bit(op1, &r1)) return false;
+            node->uses = r1;
+            node->must = r1 | FLAGS_BIT;
+            break;
+
+        case PUSH:
+            if (!register_bit(op1, &r1)) return false;
+            node->uses = r1;
+            break;
+
+        case POP:               // reads back what the routine pushed itself
+            if (!register_bit(op1, &r1)) return false;
+            node->must = r1;
+            break;
+
+        case JZ: case JNZ: case JC: case JNC: case JE: case JNE:
+        case JL: case JG: case JB: case JA: case JLE: case JGE:
+            node->uses = FLAGS_BIT;
+            node->successors[node->successor_count++] = target;
+            break;
+
+        case JMP:
+            node->successors[node->successor_count++] = target;
+            return true;        // no fall through
+
+        case CALL: {
+            if (target == routine->entry) {
+                // recursion, use the summary of the current fixpoint iteration
+                node->uses = routine->inputs;
+                node->must = routine->must_defs;
+                node->may = routine->may_defs;
+            } else {
+                MemoRoutine* callee = analyse(memo, target);
+                if (!callee || callee->status != MEMO_PURE) return false;
+                node->uses = callee->inputs;
+                node->must = callee->must_defs;
+                node->may = callee->may_defs;
+            }
+            break;
+        }
+
+        case RET:
+            return true;        // no successors
+
+        default:                // memory, devices, core id, HLT, BRK
+            return false;
+    }
+
+    node->may |= node->must;
+    node->successors[node->successor_count++] = (uint16_t)(pc + node->length);
+    return true;
+}
+
+// walks the control flow from the entry, checking the stack discipline
+static bool build_graph(Memo* memo, MemoRoutine* routine, Graph* graph) {
+    uint16_t worklist[MEMO_MAX_LENGTH];
+    size_t pending = 0;
+
+    graph->count = 0;
+    graph->nodes[graph->count++] = (Node){ .pc = routine->entry, .depth = 0 };
+    worklist[pending++] = 0;
+
+    while (pending > 0) {
+        Node* node = &graph->nodes[worklist[--pending]];
+        if (!decode(memo, routine, node)) return false;
+
+        if (node->opcode == RET && node->depth != 0) return false;     // returns through pushed data
+
+        int16_t depth = node->depth;
+        if (node->opcode == PUSH) depth++;
+        if (node->opcode == POP && --depth < 0) return false;          // reads the caller's stack
+
+        for (uint8_t i = 0; i < node->successor_count; i++) {
+            int index = find_node(graph, node->successors[i]);
+            if (index >= 0) {
+                if (graph->nodes[index].depth != depth) return false;
+                continue;
+            }
+            if (graph->count == MEMO_MAX_LENGTH) return false;
+
+            graph->nodes[graph->count] = (Node){ .pc = node->successors[i], .depth = depth };
+            worklist[pending++] = (uint16_t)graph->count++;
+        }
+    }
+    return true;
+}
+
+// must-define dataflow over the graph, yields inputs / outputs of the routine
+static bool summarise(Graph* graph, MemoRoutine* summary) {
+    for (size_t i = 0; i < graph->count; i++) graph->nodes[i].in = i == 0 ? 0 : ALL_BITS;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < graph->count; i++) {
+            Node* node = &graph->nodes[i];
+            uint64_t out = node->in | node->must;
+
+            for (uint8_t s = 0; s < node->successor_count; s++) {
+                Node* next = &graph->nodes[find_node(graph, node->successors[s])];
+                uint64_t in = next->in & out;
+                if (in != next->in) {
+                    next->in = in;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    uint64_t inputs = 0, may = 0, exit_must = ALL_BITS;
+    bool returns = false;
+    for (size_t i = 0; i < graph->count; i++) {
+        Node* node = &graph->nodes[i];
+        inputs |= node->uses & ~node->in;
+        may |= node->may;
+        if (node->opcode == RET) {
+            exit_must &= node->in;
+            returns = true;
+        }
+    }
+    if (!returns) return false;
+
+    // outputs that are not written on every path pass their input value through
+    summary->must_defs = exit_must & may;
+    summary->may_defs = may;
+    summary->inputs = inputs | (may & ~summary->must_defs);
+    return true;
+}
+
+static void mark_code(Memo* memo, const Graph* graph) {
+    for (size_t i = 0; i < graph->count; i++) {
+        for (uint8_t b = 0; b < graph->nodes[i].length; b++) {
+            uint16_t address = (uint16_t)(graph->nodes[i].pc + b);
+            memo->code[address >> 3] |= (uint8_t)(1 << (address & 7));
+            memo->bus.pages[address >> BUS_PAGE_SHIFT] |= BUS_TRAP_WRITE;
+        }
+    }
+}
+
+static MemoRoutine* analyse(Memo* memo, uint16_t entry) {
+    if (memo->routine_index[entry]) return &memo->routines[memo->routine_index[entry] - 1];
+    if (memo->routine_count == MEMO_MAX_ROUTINES) return NULL;
+
+    MemoRoutine* routine = &memo->routines[memo->routine_count++];
+    memo->routine_index[entry] = (uint16_t)memo->routine_count;
+
+    // recursive calls start out as a call that does nothing, refined until it is stable
+    *routine = (MemoRoutine){ .entry = entry, .status = MEMO_ANALYSING };
+
+    Graph* graph = malloc(sizeof(Graph));
+    if (!graph) {
+        routine->status = MEMO_IMPURE;
+        return routine;
+    }
+
+    for (int i = 0; i < MAX_FIXPOINT; i++) {
+        MemoRoutine summary = *routine;
+        if (!build_graph(memo, routine, graph) || !summarise(graph, &summary)) break;
+
+        if (summary.inputs == routine->inputs && summary.may_defs == routine->may_defs &&
+            summary.must_defs == routine->must_defs) {
+            routine->status = MEMO_PURE;
+            mark_code(memo, graph);
+            break;
+        }
+        *routine = summary;
+    }
+
+    if (routine->status != MEMO_PURE) routine->status = MEMO_IMPURE;
+    free(graph);
+    return routine;
+}
+
+// INVALIDATION
+static void invalidate(Memo* memo) {
+    memo->routine_count = 0;
+    memset(memo->routine_index, 0, sizeof(memo->routine_index));
+    memset(memo->code, 0, sizeof(memo->code));
+    memset(memo->bus.pages, 0, sizeof(memo->bus.pages));
+    memo->frame_count = 0;
+    memo->generation++;
+    memo->invalidations++;
+}
+
+// bus trap, writes to pages holding analysed code
+static void code_write_trap(void* ctx, uint16_t address, uint8_t value, bool write) {
+    Memo* memo = ctx;
+    (void)value;
+
+    if (write && (memo->code[address >> 3] & (1 << (address & 7)))) invalidate(memo);
+}
+
+// CACHE
+static void snapshot(const CPU* cpu, uint8_t* values) {
+    memcpy(values, cpu->registers, CPU_NUM_REGISTERS);
+    values[CPU_NUM_REGISTERS] = cpu->FLAGS;
+}
+
+static bool in_mask(uint64_t mask, size_t i) {
+    if (i == CPU_NUM_REGISTERS) return mask & FLAGS_BIT;
+    return i < MEMO_FLAGS_BIT && (mask & REG_BIT(i));
+}
+
+static MemoEntry* cache_slot(Memo* memo, const MemoRoutine* routine, const uint8_t* in) {
+    uint32_t hash = 2166136261u ^ routine->entry;
+
+    for (size_t i = 0; i <= CPU_NUM_REGISTERS; i++) {
+        if (in_mask(routine->inputs, i)) hash = (hash ^ in[i]) * 16777619u;
+    }
+    return &memo->cache[hash & (MEMO_CACHE_SIZE - 1)];
+}
+
+static bool cache_match(const Memo* memo, const MemoEntry* slot, const MemoRoutine* routine, const uint8_t* in) {
+    if (slot->generation != memo->generation || slot->entry != routine->entry) return false;
+
+    for (size_t i = 0; i <= CPU_NUM_REGISTERS; i++) {
+        if (in_mask(routine->inputs, i) && slot->in[i] != in[i]) return false;
+    }
+    return true;
+}
+
+static void apply(const MemoEntry* slot, const MemoRoutine* routine, CPU* cpu) {
+    for (size_t i = 0; i < CPU_NUM_REGISTERS; i++) {
+        if (in_mask(routine->may_defs, i)) cpu->registers[i] = slot->out[i];
+    }
+    if (routine->may_defs & FLAGS_BIT) cpu->FLAGS = slot->out[CPU_NUM_REGISTERS];
+}
+
+// RUN
+void memo_init(Memo* memo, RAM* ram) {
+    memset(memo, 0, sizeof(Memo));
+    memo->ram = ram;
+    memo->generation = 1;
+    memo->cache = calloc(MEMO_CACHE_SIZE, sizeof(MemoEntry));
+    if (!memo->cache) {
+        fprintf(stderr, "Error: Could not allocate memo cache\n");
+        exit(1);
+    }
+    bus_init(&memo->bus, ram);
+    bus_set_trap(&memo->bus, code_write_trap, memo);
+}
+
+void memo_free(Memo* memo) {
+    free(memo->cache);
+    memo->cache = NULL;
+}
+
+size_t memo_pure_routines(const Memo* memo) {
+    size_t count = 0;
+    for (size_t i = 0; i < memo->routine_count; i++) {
+        if (memo->routines[i].status == MEMO_PURE) count++;
+    }
+    return count;
+}
+
+// a CALL of a pure routine: skip it on a hit, otherwise start recording it
+// returns the instructions the skipped call would have taken, 0 if it was not skipped
+static uint64_t enter_call(Memo* memo, CPU* cpu, uint64_t executed) {
+    uint16_t target = (uint16_t)(ram_read(memo->ram, (uint16_t)(cpu->PC + 1)) << 8 |
+        ram_read(memo->ram, (uint16_t)(cpu->PC + 2)));
+
+    memo->calls++;
+    MemoRoutine* routine = analyse(memo, target);
+    if (!routine || routine->status != MEMO_PURE) return 0;
+
+    uint8_t in[CPU_NUM_REGISTERS + 1];
+    snapshot(cpu, in);
+
+    MemoEntry* slot = cache_slot(memo, routine, in);
+    if (cache_match(memo, slot, routine, in)) {
+        apply(slot, routine, cpu);
+        cpu->PC = (uint16_t)(cpu->PC + 3);
+        cpu->cycles += slot->cycles;
+        memo->hits++;
+        memo->skipped += slot->instructions;
+        return slot->instructions;
+    }
+
+    memo->misses++;
+    if (memo->frame_count < MEMO_MAX_FRAMES) {
+        MemoFrame* frame = &memo->frames[memo->frame_count++];
+        frame->entry = target;
+        frame->return_address = (uint16_t)(cpu->PC + 3);
+        frame->sp = cpu->SP;
+        frame->generation = memo->generation;
+        frame->start = executed;
+        frame->start_cycles = cpu->cycles;
+        memcpy(frame->in, in, sizeof(in));
+    }
+    return 0;
+}
+
+// after a RET: store the outputs of the call it finished
+static void leave_call(Memo* memo, CPU* cpu, uint64_t executed) {
+    // frames the guest unwound without returning through them
+    while (memo->frame_count > 0 && memo->frames[memo->frame_count - 1].sp < cpu->SP) {
+        memo->frame_count--;
+    }
+    if (memo->frame_count == 0) return;
+
+    MemoFrame* frame = &memo->frames[memo->frame_count - 1];
+    if (frame->sp != cpu->SP || frame->return_address != cpu->PC) return;
+    memo->frame_count--;
+
+    if (frame->generation != memo->generation) return;
+    MemoRoutine* routine = analyse(memo, frame->entry);
+    if (!routine || routine->status != MEMO_PURE) return;
+
+    MemoEntry* slot = cache_slot(memo, routine, frame->in);
+    slot->generation = memo->generation;
+    slot->entry = frame->entry;
+    memcpy(slot->in, frame->in, sizeof(slot->in));
+    snapshot(cpu, slot->out);
+    slot->instructions = executed - frame->start;
+    slot->cycles = cpu->cycles - frame->start_cycles;
+}
+
+uint64_t memo_run(Memo* memo, CPU* cpu, uint64_t budget) {
+    uint64_t executed = 0;
+
+    while (executed < budget && !cpu->halted) {
+        uint8_t opcode = ram_read(memo->ram, cpu->PC);
+
+        if (opcode == CALL) {
+            uint64_t skipped = enter_call(memo, cpu, executed);
+            if (skipped) {
+                executed += skipped;
+                continue;
+            }
+        }
+
+        cpu_step_bus(cpu, &memo->bus);
+        executed++;
+
+        if (opcode == RET) leave_call(memo, cpu, executed);
+    }
+
+    return executed;
+}
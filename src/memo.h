@@ -0,0 +1,95 @@
+#ifndef MEMO_H
+#define MEMO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "cpu.h"
+#include "bus.h"
+
+// Memoization of pure guest subroutines.
+//
+// Every CALL target is analysed once: the routine and everything it calls is walked
+// along its control flow. A routine is pure if it touches no memory except the stack
+// it pushes itself (no LDA/STA/TAS/CAS/IN/OUT/CPUID/HLT) and returns with a balanced
+// stack. The analysis yields the registers (and flags) it reads before writing them,
+// its inputs, and the ones it may write, its outputs.
+//
+// On a CALL of a pure routine the inputs are looked up in a bounded, direct-mapped
+// cache. A hit writes the cached outputs and skips the call, a miss runs the call and
+// stores its outputs when the matching RET is reached. Writes to the code of any
+// analysed routine (seen through the bus page table) drop all analyses and entries.
+//
+// Skipped calls leave the memory below SP untouched, a guest that reads garbage
+// below its stack pointer will notice.
+
+#define MEMO_MAX_ROUTINES   256
+#define MEMO_CACHE_SIZE     4096        // entries, power of two
+#define MEMO_MAX_FRAMES     64          // pending calls being recorded
+#define MEMO_MAX_LENGTH     512         // instructions analysed per routine
+
+#define MEMO_FLAGS_BIT      63          // FLAGS in the register masks below
+
+typedef enum {
+    MEMO_UNKNOWN = 0,
+    MEMO_ANALYSING,
+    MEMO_PURE,
+    MEMO_IMPURE,
+} MemoStatus;
+
+typedef struct {
+    uint16_t entry;
+    uint8_t status;         // MemoStatus
+    uint64_t inputs;        // read before written, bit per register + MEMO_FLAGS_BIT
+    uint64_t may_defs;      // written on some path
+    uint64_t must_defs;     // written on every path
+} MemoRoutine;
+
+typedef struct {
+    uint32_t generation;    // 0 = empty
+    uint16_t entry;
+    uint8_t in[CPU_NUM_REGISTERS + 1];     // input registers, FLAGS last
+    uint8_t out[CPU_NUM_REGISTERS + 1];
+    uint64_t instructions;  // instructions the call took
+    uint64_t cycles;        // and its cycles, charged on a hit
+} MemoEntry;
+
+typedef struct {
+    uint16_t entry;
+    uint16_t return_address;
+    uint16_t sp;            // SP before the CALL
+    uint32_t generation;
+    uint64_t start;         // instruction count at the CALL
+    uint64_t start_cycles;
+    uint8_t in[CPU_NUM_REGISTERS + 1];
+} MemoFrame;
+
+typedef struct {
+    Bus bus;
+    RAM* ram;
+
+    MemoRoutine routines[MEMO_MAX_ROUTINES];
+    size_t routine_count;
+    uint16_t routine_index[RAM_SIZE];               // entry address -> routine + 1
+    uint8_t code[RAM_SIZE / 8];                     // bitmap of analysed code bytes
+
+    MemoEntry* cache;
+    uint32_t generation;
+
+    MemoFrame frames[MEMO_MAX_FRAMES];
+    size_t frame_count;
+
+    // statistics
+    uint64_t calls, hits, misses, invalidations;
+    uint64_t skipped;       // instructions not executed thanks to hits
+} Memo;
+
+void memo_init(Memo* memo, RAM* ram);
+void memo_free(Memo* memo);
+
+// like cpu_run, instructions of skipped calls count towards the budget
+uint64_t memo_run(Memo* memo, CPU* cpu, uint64_t budget);
+
+size_t memo_pure_routines(const Memo* memo);
+
+#endif //MEMO_H
@@ -0,0 +1,161 @@
+#include "native.h"
+
+#include <string.h>
+
+NativeBinding native_bindings[NATIVE_MAX_BINDINGS];
+size_t native_binding_count;
+
+// NATIVES
+// A * B, A = low byte, B = high byte
+static void native_mul8(CPU* cpu) {
+    uint16_t product = (uint16_t)(cpu->registers[A] * cpu->registers[B]);
+    cpu->registers[A] = (uint8_t)(product & 0xFF);
+    cpu->registers[B] = (uint8_t)(product >> 8);
+}
+
+// A / B, A = quotient, B = remainder. Dividing by 0 gives what restoring division
+// gives: quotient 0xFF, remainder A
+static void native_div8(CPU* cpu) {
+    uint8_t dividend = cpu->registers[A];
+    uint8_t divisor = cpu->registers[B];
+    if (divisor == 0) {
+        cpu->registers[A] = 0xFF;
+        cpu->registers[B] = dividend;
+        return;
+    }
+    cpu->registers[A] = dividend / divisor;
+    cpu->registers[B] = dividend % divisor;
+}
+
+// default cycles are what the shift-and-add / restoring division loops in
+// sample/native_math.asm take on average
+static const NativeRoutine natives[] = {
+    {"mul8", 260, native_mul8},
+    {"div8", 215, native_div8},
+};
+
+const NativeRoutine* native_find(const char* name) {
+    for (size_t i = 0; i < sizeof(natives) / sizeof(natives[0]); i++) {
+        if (strcmp(natives[i].name, name) == 0) return &natives[i];
+    }
+    return NULL;
+}
+
+void native_list(FILE* out) {
+    for (size_t i = 0; i < sizeof(natives) / sizeof(natives[0]); i++) {
+        fprintf(out, "%s%s", i ? ", " : "", natives[i].name);
+    }
+    fprintf(out, "\n");
+}
+
+// BINDINGS
+static void patch(RAM* ram, const NativeBinding* binding, uint8_t id) {
+    ram_write(ram, binding->address, HCALL);
+    ram_write(ram, (uint16_t)(binding->address + 1), id);
+}
+
+static void unpatch(RAM* ram, const NativeBinding* binding) {
+    for (uint16_t i = 0; i < ISA_LENGTH_IMM8; i++) {
+        ram_write(ram, (uint16_t)(binding->address + i), binding->original[i]);
+    }
+}
+
+static NativeBinding* add_binding(const NativeRoutine* routine, uint16_t address, uint64_t cycles) {
+    if (native_binding_count == NATIVE_MAX_BINDINGS) return NULL;
+
+    NativeBinding* binding = &native_bindings[native_binding_count++];
+    memset(binding, 0, sizeof(NativeBinding));
+    binding->routine = routine;
+    binding->address = address;
+    binding->cycles = cycles ? cycles : routine->cycles;
+    return binding;
+}
+
+bool native_bind(RAM* ram, const NativeRoutine* routine, uint16_t address, uint64_t cycles) {
+    // the HCALL must not cut into the instruction after the entry
+    if (cpu_opcodes[ram_read(ram, address)].length < ISA_LENGTH_IMM8) return false;
+
+    NativeBinding* binding = add_binding(routine, address, cycles);
+    if (!binding) return false;
+
+    for (uint16_t i = 0; i < ISA_LENGTH_IMM8; i++) {
+        binding->original[i] = ram_read(ram, (uint16_t)(address + i));
+    }
+    patch(ram, binding, (uint8_t)(binding - native_bindings));
+    return true;
+}
+
+bool native_rebind(const NativeRoutine* routine, uint16_t address, uint64_t cycles,
+                   const uint8_t original[ISA_LENGTH_IMM8]) {
+    NativeBinding* binding = add_binding(routine, address, cycles);
+    if (!binding) return false;
+
+    memcpy(binding->original, original, ISA_LENGTH_IMM8);
+    return true;
+}
+
+// VERIFICATION
+static void print_registers(const char* label, const CPU* cpu) {
+    printf("    %-7s", label);
+    for (size_t i = 0; i < CPU_NUM_REGISTERS; i++) printf(" %02x", cpu->registers[i]);
+    printf("  PC:0x%04x SP:0x%04x%s\n", cpu->PC, cpu->SP, cpu->halted ? " halted" : "");
+}
+
+// the register contract, FLAGS and memory are not part of it (see native.h)
+static bool same_result(const CPU* guest, const CPU* native) {
+    return !guest->halted && guest->PC == native->PC && guest->SP == native->SP &&
+        memcmp(guest->registers, native->registers, CPU_NUM_REGISTERS) == 0;
+}
+
+// the CPU is on the HCALL of `binding`, returns the instructions the guest path took
+static uint64_t verify_call(CPU* cpu, RAM* ram, NativeBinding* binding) {
+    uint8_t id = (uint8_t)(binding - native_bindings);
+    CPU input = *cpu;
+
+    // native path on a copy, returning like HCALL does
+    CPU native = *cpu;
+    binding->routine->run(&native);
+    native.PC = (uint16_t)(ram_read(ram, native.SP) << 8 | ram_read(ram, (uint16_t)(native.SP + 1)));
+    native.SP = (uint16_t)(native.SP + 2);
+
+    // guest path, with the original code in place until the call returns
+    unpatch(ram, binding);
+    uint64_t executed = 0;
+    while (!cpu->halted && executed < NATIVE_VERIFY_LIMIT) {
+        cpu_step(cpu, ram);
+        executed++;
+        if (cpu->SP == native.SP && cpu->PC == native.PC) break;
+    }
+    patch(ram, binding, id);
+
+    binding->calls++;
+    binding->guest_cycles += cpu->cycles - input.cycles;
+    if (!same_result(cpu, &native)) {
+        if (binding->mismatches++ < NATIVE_VERIFY_REPORT) {
+            printf("Native: %s at 0x%04x differs from the guest routine\n",
+                binding->routine->name, binding->address);
+            print_registers("input", &input);
+            print_registers("guest", cpu);
+            print_registers("native", &native);
+        }
+    }
+    return executed;
+}
+
+uint64_t native_verify_run(CPU* cpu, RAM* ram, uint64_t budget) {
+    uint64_t executed = 0;
+
+    while (executed < budget && !cpu->halted) {
+        if (ram_read(ram, cpu->PC) == HCALL) {
+            uint8_t id = ram_read(ram, (uint16_t)(cpu->PC + 1));
+            if (id < native_binding_count && native_bindings[id].address == cpu->PC) {
+                executed += verify_call(cpu, ram, &native_bindings[id]);
+                continue;
+            }
+        }
+        cpu_step(cpu, ram);
+        executed++;
+    }
+
+    return executed;
+}
@@ -0,0 +1,77 @@
+#ifndef NATIVE_H
+#define NATIVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "cpu.h"
+#include "ram.h"
+
+// Native host implementations of guest routines (hypercalls).
+//
+// Binding a native to a guest routine patches HCALL <binding> over its entry, the same
+// way the debugger patches BRK. A CALL of the routine lands on the HCALL: the host runs
+// the native on the CPU registers, charges the binding's cycles and returns like RET.
+// The guest code of the routine is not executed, code without bindings is unaffected.
+//
+// Natives implement a register contract (see native.c): they write their outputs and
+// leave every other register alone. Nothing else is part of it: a native leaves FLAGS
+// as they were and writes no memory, while the guest routine leaves whatever flags its
+// last instruction set and may use scratch memory. Callers must not branch on flags
+// or read the routine's scratch memory after the CALL. native_verify_run checks the
+// registers, SP and return address only, flags and memory are not compared.
+
+#define NATIVE_MAX_BINDINGS     256         // HCALL takes an 8-bit binding number
+#define NATIVE_VERIFY_LIMIT     (1 << 20)   // instructions a verified guest call may take
+#define NATIVE_VERIFY_REPORT    8           // mismatches printed
+
+typedef struct {
+    const char* name;
+    uint64_t cycles;            // default charge, what a straightforward guest loop takes
+    void (*run)(CPU* cpu);
+} NativeRoutine;
+
+typedef struct {
+    const NativeRoutine* routine;
+    uint16_t address;           // entry of the guest routine
+    uint64_t cycles;            // charged per call
+    uint8_t original[ISA_LENGTH_IMM8];      // guest bytes under the HCALL
+
+    // native_verify_run only
+    uint64_t calls;
+    uint64_t mismatches;
+    uint64_t guest_cycles;
+} NativeBinding;
+
+extern NativeBinding native_bindings[NATIVE_MAX_BINDINGS];
+extern size_t native_binding_count;
+
+// NULL if there is no native called `name`
+const NativeRoutine* native_find(const char* name);
+void native_list(FILE* out);
+
+// patches HCALL over the routine at `address`, `cycles` 0 = the native's default,
+// false if all bindings are taken or the entry instruction is shorter than the HCALL
+bool native_bind(RAM* ram, const NativeRoutine* routine, uint16_t address, uint64_t cycles);
+
+// registers a binding whose HCALL is already in memory (a loaded trace), false if all
+// bindings are taken. Bindings keep their order, the HCALL operand is the index
+bool native_rebind(const NativeRoutine* routine, uint16_t address, uint64_t cycles,
+                   const uint8_t original[ISA_LENGTH_IMM8]);
+
+// HCALL <id>, false if there is no such binding
+static inline bool native_call(CPU* cpu, uint8_t id) {
+    if (id >= native_binding_count) return false;
+
+    const NativeBinding* binding = &native_bindings[id];
+    binding->routine->run(cpu);
+    cpu->cycles += binding->cycles;
+    return true;
+}
+
+// like cpu_run, but every call of a bound routine runs natively on a copy of the CPU and
+// then through the original guest code, the results are compared and the guest one kept
+uint64_t native_verify_run(CPU* cpu, RAM* ram, uint64_t budget);
+
+#endif //NATIVE_H
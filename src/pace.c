@@ -0,0 +1,76 @@
+#include "pace.h"
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#define NSEC_PER_SEC 1000000000ull
+
+static uint64_t to_ns(const struct timespec* ts) {
+    return (uint64_t)ts->tv_sec * NSEC_PER_SEC + (uint64_t)ts->tv_nsec;
+}
+
+static struct timespec from_ns(uint64_t ns) {
+    struct timespec ts = { (time_t)(ns / NSEC_PER_SEC), (long)(ns % NSEC_PER_SEC) };
+    return ts;
+}
+
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return to_ns(&ts);
+}
+
+uint64_t pace_run(CPU* cpu, RAM* ram, uint64_t hz, uint64_t batch, Stats* live, PaceStats* stats) {
+    memset(stats, 0, sizeof(PaceStats));
+    if (hz == 0) hz = 1;
+    if (batch == 0) batch = 1;
+
+    uint64_t start = clock_ns(CLOCK_MONOTONIC);
+    uint64_t start_cpu = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    uint64_t start_cycles = cpu->cycles;
+
+    // running mean and variance of the wakeup latency (Welford)
+    double mean = 0, m2 = 0, max = 0;
+    uint64_t wakeups = 0;
+
+    while (!cpu->halted) {
+        uint64_t ran = cpu_run_cycles(cpu, ram, cpu->cycles + batch);
+        stats->instructions += ran;
+        stats->batches++;
+        if (live) stats_update(live, cpu, ram, ran);
+
+        // when the guest reaches this cycle count at the target clock
+        uint64_t elapsed = cpu->cycles - start_cycles;
+        uint64_t deadline = start + (uint64_t)((unsigned __int128)elapsed * NSEC_PER_SEC / hz);
+
+        if (clock_ns(CLOCK_MONOTONIC) >= deadline) {
+            stats->late++;
+            continue;
+        }
+
+        struct timespec until = from_ns(deadline);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR) {}
+
+        double latency = (double)(clock_ns(CLOCK_MONOTONIC) - deadline) / 1e9;
+        wakeups++;
+        double delta = latency - mean;
+        mean += delta / (double)wakeups;
+        m2 += delta * (latency - mean);
+        if (latency > max) max = latency;
+    }
+
+    if (live) stats_finish(live, cpu);
+
+    uint64_t end = clock_ns(CLOCK_MONOTONIC);
+    stats->cycles = cpu->cycles - start_cycles;
+    stats->seconds = (double)(end - start) / 1e9;
+    stats->drift = stats->seconds - (double)stats->cycles / (double)hz;
+    stats->jitter_mean = mean;
+    stats->jitter_stddev = wakeups > 1 ? sqrt(m2 / (double)(wakeups - 1)) : 0;
+    stats->jitter_max = max;
+    stats->cpu_seconds = (double)(clock_ns(CLOCK_THREAD_CPUTIME_ID) - start_cpu) / 1e9;
+
+    return stats->instructions;
+}
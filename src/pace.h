@@ -0,0 +1,35 @@
+#ifndef PACE_H
+#define PACE_H
+
+#include <stdint.h>
+#include "cpu.h"
+#include "ram.h"
+#include "stats.h"
+
+// Real-time pacing at a fixed guest clock.
+//
+// The CPU runs a batch of cycles at full speed, then sleeps with clock_nanosleep until
+// the absolute time the batch ends at the target clock. Deadlines are computed from the
+// start time and the total cycle count, so late wakeups do not add up to drift. Host
+// CPU use is roughly proportional to the target clock.
+
+#define PACE_DEFAULT_BATCH_US   1000        // guest time per batch
+
+typedef struct {
+    uint64_t instructions;
+    uint64_t cycles;
+    uint64_t batches;
+    uint64_t late;              // batches that finished after their deadline
+    double seconds;             // wall clock time
+    double drift;               // wall clock minus guest time at the end, seconds
+    double jitter_mean;         // wakeup latency after the deadline, seconds
+    double jitter_stddev;
+    double jitter_max;
+    double cpu_seconds;         // host CPU time of the pacing thread
+} PaceStats;
+
+// runs the CPU at `hz` cycles per second until it halts, `batch` cycles between sleeps,
+// `live` (may be NULL) is updated after every batch
+uint64_t pace_run(CPU* cpu, RAM* ram, uint64_t hz, uint64_t batch, Stats* live, PaceStats* stats);
+
+#endif //PACE_H
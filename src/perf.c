@@ -0,0 +1,63 @@
+#include "perf.h"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const uint64_t configs[PERF_COUNTERS] = {
+    [PERF_DTLB_MISSES] = PERF_COUNT_HW_CACHE_DTLB |
+        PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16,
+    [PERF_ITLB_MISSES] = PERF_COUNT_HW_CACHE_ITLB |
+        PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16,
+};
+
+static const char* names[PERF_COUNTERS] = {
+    [PERF_DTLB_MISSES] = "dTLB misses",
+    [PERF_ITLB_MISSES] = "iTLB misses",
+};
+
+void perf_start(Perf* perf) {
+    perf->error = 0;
+
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = configs[i];
+        attr.disabled = 1;
+        attr.inherit = 1;           // worker threads started later count too
+        attr.exclude_kernel = 1;    // allowed with the default perf_event_paranoid
+        attr.exclude_hv = 1;
+
+        perf->fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (perf->fd[i] < 0) {
+            if (!perf->error) perf->error = errno;
+            continue;
+        }
+        ioctl(perf->fd[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(perf->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+bool perf_stop(Perf* perf, PerfEvent event, uint64_t* value) {
+    int fd = perf->fd[event];
+    if (fd < 0) return false;
+
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    return read(fd, value, sizeof(*value)) == (ssize_t)sizeof(*value);
+}
+
+void perf_close(Perf* perf) {
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        if (perf->fd[i] >= 0) close(perf->fd[i]);
+        perf->fd[i] = -1;
+    }
+}
+
+const char* perf_event_name(PerfEvent event) {
+    return names[event];
+}
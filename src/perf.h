@@ -0,0 +1,29 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Hardware event counters of this process and the threads it starts after perf_start,
+// through perf_event_open. Counters the kernel or the (virtual) CPU does not offer
+// stay unavailable, nothing else is affected.
+
+typedef enum {
+    PERF_DTLB_MISSES = 0,       // data TLB load misses
+    PERF_ITLB_MISSES,           // instruction TLB misses
+    PERF_COUNTERS
+} PerfEvent;
+
+typedef struct {
+    int fd[PERF_COUNTERS];      // -1 = unavailable
+    int error;                  // errno of the first counter that could not be opened
+} Perf;
+
+void perf_start(Perf* perf);
+// stops `event` and reads it, false if it was unavailable
+bool perf_stop(Perf* perf, PerfEvent event, uint64_t* value);
+void perf_close(Perf* perf);
+
+const char* perf_event_name(PerfEvent event);
+
+#endif //PERF_H
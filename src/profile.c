@@ -0,0 +1,206 @@
+#include "profile.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "native.h"
+
+// SHADOW STACK
+static inline void profile_call(Profiler* profiler, uint16_t from, uint16_t to) {
+    if (profiler->depth == PROFILE_MAX_DEPTH) {
+        profiler->overflow++;
+        return;
+    }
+    profiler->frames[profiler->depth].entry = to;
+    profiler->frames[profiler->depth].return_address = (uint16_t)(from + ISA_LENGTH_ADDR);
+    profiler->depth++;
+}
+
+static inline void profile_return(Profiler* profiler, uint16_t to) {
+    if (profiler->overflow) {
+        profiler->overflow--;
+        return;
+    }
+    // usually the top frame, a routine may also return past frames that never returned
+    for (size_t i = profiler->depth; i > 0; i--) {
+        if (profiler->frames[i - 1].return_address == to) {
+            profiler->depth = i - 1;
+            return;
+        }
+    }
+    profiler->unmatched++;
+}
+
+// PROFILING ENGINE
+static void profile_step(CPU* cpu, Profiler* mem);
+
+#define EXEC_NAME profile_step
+#define EXEC_MEMORY Profiler
+#define MEM_READ(mem, addr) ram_read((mem)->ram, addr)
+#define MEM_FETCH(mem, addr) ram_read((mem)->ram, addr)
+#define MEM_WRITE(mem, addr, value) ram_write((mem)->ram, addr, value)
+#define MEM_TEST_AND_SET(mem, addr) ram_test_and_set((mem)->ram, addr)
+#define MEM_COMPARE_EXCHANGE(mem, addr, expected, desired) ram_compare_exchange((mem)->ram, addr, expected, desired)
+#define EXEC_EDGE(mem, from, to) ((void)(from))
+#define EXEC_CALL(mem, from, to) profile_call(mem, from, to)
+#define EXEC_RET(mem, from, to) profile_return(mem, to)
+#include "cpu_exec.h"
+#undef EXEC_NAME
+#undef EXEC_MEMORY
+#undef MEM_READ
+#undef MEM_FETCH
+#undef MEM_WRITE
+#undef MEM_TEST_AND_SET
+#undef MEM_COMPARE_EXCHANGE
+#undef EXEC_EDGE
+#undef EXEC_CALL
+#undef EXEC_RET
+
+// SAMPLES
+static uint32_t hash_frames(const ProfileFrame* frames, size_t depth) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < depth; i++) {
+        hash = (hash ^ frames[i].entry) * 16777619u;
+        hash = (hash ^ (frames[i].entry >> 8)) * 16777619u;
+    }
+    return hash;
+}
+
+static bool same_stack(const Profiler* profiler, const ProfileStack* stack) {
+    if (stack->depth != profiler->depth) return false;
+
+    const uint16_t* entries = profiler->pool + stack->offset;
+    for (size_t i = 0; i < profiler->depth; i++) {
+        if (entries[i] != profiler->frames[i].entry) return false;
+    }
+    return true;
+}
+
+static void profile_sample(Profiler* profiler) {
+    profiler->samples++;
+
+    uint32_t hash = hash_frames(profiler->frames, profiler->depth);
+    for (size_t probe = 0; probe < PROFILE_TABLE_SIZE; probe++) {
+        ProfileStack* stack = &profiler->stacks[(hash + probe) & (PROFILE_TABLE_SIZE - 1)];
+
+        if (stack->count && stack->hash == hash && same_stack(profiler, stack)) {
+            stack->count++;
+            return;
+        }
+        if (stack->count) continue;
+
+        // first sample of this stack, copy its entries to the pool
+        if (profiler->pool_used + profiler->depth > profiler->pool_capacity) {
+            size_t capacity = profiler->pool_capacity * 2 + profiler->depth;
+            uint16_t* pool = realloc(profiler->pool, capacity * sizeof(uint16_t));
+            if (!pool) break;
+            profiler->pool = pool;
+            profiler->pool_capacity = capacity;
+        }
+        for (size_t i = 0; i < profiler->depth; i++) {
+            profiler->pool[profiler->pool_used + i] = profiler->frames[i].entry;
+        }
+        stack->hash = hash;
+        stack->depth = (uint32_t)profiler->depth;
+        stack->offset = profiler->pool_used;
+        stack->count = 1;
+        profiler->pool_used += profiler->depth;
+        profiler->stack_count++;
+        return;
+    }
+    profiler->dropped++;
+}
+
+// TIMER
+static volatile sig_atomic_t profile_tick;
+
+static void on_sigprof(int signal) {
+    (void)signal;
+    profile_tick = 1;
+}
+
+static void set_timer(uint64_t hz) {
+    struct itimerval timer = {0};
+    if (hz) {
+        uint64_t us = 1000000 / hz ? 1000000 / hz : 1;
+        timer.it_interval.tv_sec = (time_t)(us / 1000000);
+        timer.it_interval.tv_usec = (suseconds_t)(us % 1000000);
+        timer.it_value = timer.it_interval;
+    }
+    setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+// PROFILER
+void profile_init(Profiler* profiler, RAM* ram, uint64_t period, uint64_t timer_hz) {
+    memset(profiler, 0, sizeof(Profiler));
+    profiler->ram = ram;
+    profiler->period = period;
+    profiler->timer_hz = timer_hz;
+    if (!period && !timer_hz) profiler->period = PROFILE_DEFAULT_PERIOD;
+
+    profiler->stacks = calloc(PROFILE_TABLE_SIZE, sizeof(ProfileStack));
+    if (!profiler->stacks) {
+        fprintf(stderr, "Error: Could not allocate the profile table\n");
+        exit(1);
+    }
+}
+
+void profile_free(Profiler* profiler) {
+    free(profiler->stacks);
+    free(profiler->pool);
+    profiler->stacks = NULL;
+    profiler->pool = NULL;
+}
+
+uint64_t profile_run(Profiler* profiler, CPU* cpu, uint64_t budget) {
+    uint64_t executed = 0;
+    uint64_t chunk = profiler->period ? profiler->period : PROFILE_TIMER_CHUNK;
+
+    if (!profiler->period) {
+        signal(SIGPROF, on_sigprof);
+        profile_tick = 0;
+        set_timer(profiler->timer_hz);
+    }
+
+    while (executed < budget && !cpu->halted) {
+        uint64_t limit = budget - executed < chunk ? budget - executed : chunk;
+        uint64_t ran = 0;
+        while (ran < limit && !cpu->halted) {
+            profile_step(cpu, profiler);
+            ran++;
+        }
+        executed += ran;
+
+        if (profiler->period) {
+            if (ran == chunk) profile_sample(profiler);
+        } else if (profile_tick) {
+            profile_tick = 0;
+            profile_sample(profiler);
+        }
+    }
+
+    if (!profiler->period) {
+        set_timer(0);
+        signal(SIGPROF, SIG_DFL);
+    }
+    return executed;
+}
+
+void profile_write_folded(const Profiler* profiler, FILE* out) {
+    char name[96];
+    for (size_t i = 0; i < PROFILE_TABLE_SIZE; i++) {
+        const ProfileStack* stack = &profiler->stacks[i];
+        if (!stack->count) continue;
+
+        // the program entry is the root of every stack
+        symbols_format(profiler->symbols, 0x0000, name, sizeof(name));
+        fputs(name[0] == '0' ? "[entry]" : name, out);
+        for (size_t j = 0; j < stack->depth; j++) {
+            symbols_format(profiler->symbols, profiler->pool[stack->offset + j], name, sizeof(name));
+            fprintf(out, ";%s", name);
+        }
+        fprintf(out, " %llu\n", (unsigned long long)stack->count);
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "cpu.h"
+#include "ram.h"
+#include "symbols.h"
+
+// Sampling call-graph profiler.
+//
+// The profiler runs its own engine whose CALL and RET hooks keep a shadow call stack
+// on the host: CALL pushes the routine and its return address, RET pops back to the
+// frame it returns to (RETs that match no frame, like a pushed address used as a jump,
+// leave the stack alone). Every `period` instructions, or on every SIGPROF tick of a
+// host timer, the current stack is counted in a hash table of distinct stacks.
+//
+// The result is written as folded stacks ("MAIN;FACTORIAL;FACTORIAL 42" per line) for
+// flamegraph.pl and friends. Routine names come from `symbols`, a loaded map file.
+
+#define PROFILE_MAX_DEPTH       256         // shadow stack frames kept
+#define PROFILE_TABLE_SIZE      16384       // distinct stacks, power of two
+#define PROFILE_DEFAULT_PERIOD  10007       // instructions between samples, prime so loops don't alias
+#define PROFILE_TIMER_CHUNK     1024        // instructions between checks for a timer tick
+
+typedef struct {
+    uint16_t entry;             // routine called
+    uint16_t return_address;
+} ProfileFrame;
+
+typedef struct {
+    uint32_t hash;
+    uint32_t depth;
+    size_t offset;              // into the frame pool
+    uint64_t count;             // 0 = empty slot
+} ProfileStack;
+
+typedef struct {
+    RAM* ram;
+
+    ProfileFrame frames[PROFILE_MAX_DEPTH];
+    size_t depth;
+    uint64_t overflow;          // pending calls deeper than PROFILE_MAX_DEPTH
+
+    uint64_t period;            // instructions between samples, 0 = timer
+    uint64_t timer_hz;
+
+    ProfileStack* stacks;
+    size_t stack_count;
+    uint16_t* pool;             // routine entries of all stacks, outermost first
+    size_t pool_used, pool_capacity;
+
+    const SymbolTable* symbols; // routine names, may be NULL
+
+    // statistics
+    uint64_t samples;
+    uint64_t dropped;           // samples lost to a full table
+    uint64_t unmatched;         // RETs that matched no frame
+} Profiler;
+
+// `period` > 0 samples every `period` instructions, otherwise `timer_hz` SIGPROF ticks
+// per second of host CPU time
+void profile_init(Profiler* profiler, RAM* ram, uint64_t period, uint64_t timer_hz);
+void profile_free(Profiler* profiler);
+
+// like cpu_run
+uint64_t profile_run(Profiler* profiler, CPU* cpu, uint64_t budget);
+
+void profile_write_folded(const Profiler* profiler, FILE* out);
+
+#endif //PROFILE_H
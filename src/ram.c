@@ -1,15 +1,39 @@
 #include "ram.h"
 
+#include <sys/mman.h>
+
 void ram_init(RAM* ram) {
     for (int i = 0; i < RAM_SIZE; i++) {
         ram->memory[i] = 0;
     }
 }
 
+// one anonymous mapping for all instances: the kernel hands out zero pages on
+// first touch, so an idle guest only costs the pages its code and stack live in
+RAM* ram_alloc(size_t count) {
+    void* memory = mmap(NULL, count * sizeof(RAM), PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return memory == MAP_FAILED ? NULL : memory;
+}
+
+void ram_free(RAM* ram, size_t count) {
+    if (ram) munmap(ram, count * sizeof(RAM));
+}
+
 uint8_t ram_read(RAM* ram, uint16_t address) {
     return ram->memory[address];
 }
 
 void ram_write(RAM* ram, uint16_t address, uint8_t value) {
     ram->memory[address] = value;
-}
\ No newline at end of file
+}
+
+uint8_t ram_test_and_set(RAM* ram, uint16_t address) {
+    return __atomic_exchange_n(&ram->memory[address], 1, __ATOMIC_SEQ_CST);
+}
+
+// on failure *expected receives the current value
+bool ram_compare_exchange(RAM* ram, uint16_t address, uint8_t* expected, uint8_t desired) {
+    return __atomic_compare_exchange_n(&ram->memory[address], expected, desired,
+        false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
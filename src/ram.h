@@ -2,6 +2,8 @@
 #define RAM_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 #define RAM_SIZE 65536  // 64 KiB RAM
 
@@ -10,7 +12,13 @@ typedef struct {
 } RAM;
 
 void ram_init(RAM* ram);
+RAM* ram_alloc(size_t count);   // zeroed, pages are only backed once touched
+void ram_free(RAM* ram, size_t count);
 uint8_t ram_read(RAM* ram, uint16_t address);                   // RAM-read
 void ram_write(RAM* ram, uint16_t address, uint8_t value);      // RAM-write
 
+// atomic accesses, safe when several CPUs share one RAM
+uint8_t ram_test_and_set(RAM* ram, uint16_t address);           // returns old value, stores 1
+bool ram_compare_exchange(RAM* ram, uint16_t address, uint8_t* expected, uint8_t desired);
+
 #endif //RAM_H
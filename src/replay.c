@@ -0,0 +1,451 @@
+#include "replay.h"
+#include "native.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_MAGIC   "ETRC"
+#define TRACE_VERSION 4
+
+static void* checked_realloc(void* ptr, size_t size) {
+    void* result = realloc(ptr, size);
+    if (!result) {
+        fprintf(stderr, "Error: Could not allocate trace memory\n");
+        exit(1);
+    }
+    return result;
+}
+
+// COMPRESSION
+// PackBits style: control byte c < 128 is followed by c + 1 literal bytes,
+// c >= 128 repeats the next byte c - 125 times (3 .. 130)
+static size_t run_length(const uint8_t* src, size_t i, size_t n) {
+    size_t run = 1;
+    while (i + run < n && run < 130 && src[i + run] == src[i]) run++;
+    return run;
+}
+
+static size_t pack(const uint8_t* src, size_t n, uint8_t* out) {
+    size_t i = 0, o = 0;
+
+    while (i < n) {
+        size_t run = run_length(src, i, n);
+        if (run >= 3) {
+            out[o++] = (uint8_t)(run + 125);
+            out[o++] = src[i];
+            i += run;
+            continue;
+        }
+
+        size_t start = i, count = 0;
+        while (i < n && count < 128 && run_length(src, i, n) < 3) {
+            i++;
+            count++;
+        }
+        out[o++] = (uint8_t)(count - 1);
+        memcpy(&out[o], &src[start], count);
+        o += count;
+    }
+
+    return o;
+}
+
+// decodes into dst, XORed with base unless base is NULL
+static void unpack(const uint8_t* src, size_t size, uint8_t* dst, const uint8_t* base) {
+    size_t i = 0, o = 0;
+
+    while (i < size) {
+        uint8_t control = src[i++];
+        if (control < 128) {
+            size_t count = (size_t)control + 1;
+            if (i + count > size || o + count > RAM_SIZE) break;     // corrupt data
+            memcpy(&dst[o], &src[i], count);
+            i += count;
+            o += count;
+        } else {
+            size_t count = (size_t)control - 125;
+            if (i >= size || o + count > RAM_SIZE) break;
+            memset(&dst[o], src[i++], count);
+            o += count;
+        }
+    }
+
+    if (base) {
+        for (size_t j = 0; j < RAM_SIZE; j++) dst[j] ^= base[j];
+    }
+}
+
+// IO
+static uint8_t record_read(void* ctx, uint8_t port) {
+    Trace* trace = ctx;
+    uint8_t value = io_in(trace->live, port);
+
+    if (trace->input_count == trace->input_capacity) {
+        trace->input_capacity = trace->input_capacity ? trace->input_capacity * 2 : 256;
+        trace->inputs = checked_realloc(trace->inputs, trace->input_capacity);
+    }
+    trace->inputs[trace->input_count++] = value;
+    return value;
+}
+
+static void record_write(void* ctx, uint8_t port, uint8_t value) {
+    Trace* trace = ctx;
+    io_out(trace->live, port, value);
+}
+
+static uint8_t replay_read(void* ctx, uint8_t port) {
+    Trace* trace = ctx;
+    (void)port;
+
+    if (trace->input_cursor >= trace->input_count) return 0;
+    return trace->inputs[trace->input_cursor++];
+}
+
+static void replay_write(void* ctx, uint8_t port, uint8_t value) {
+    // output was produced during the recording already
+    (void)ctx;
+    (void)port;
+    (void)value;
+}
+
+static void attach_io(Trace* trace, bool recording) {
+    trace->io.read = recording ? record_read : replay_read;
+    trace->io.write = recording ? record_write : replay_write;
+    trace->io.ctx = trace;
+}
+
+// CHECKPOINTS
+static void take_checkpoint(Trace* trace, CPU* cpu, RAM* ram, uint64_t icount) {
+    uint8_t* delta = trace->delta->memory;
+    uint8_t* packed = trace->packed;
+
+    if (trace->checkpoint_count == trace->checkpoint_capacity) {
+        trace->checkpoint_capacity = trace->checkpoint_capacity ? trace->checkpoint_capacity * 2 : 64;
+        trace->checkpoints = checked_realloc(trace->checkpoints,
+            trace->checkpoint_capacity * sizeof(Checkpoint));
+    }
+
+    size_t size;
+    if (trace->checkpoint_count == 0) {
+        memcpy(trace->base, ram, sizeof(RAM));
+        size = pack(ram->memory, RAM_SIZE, packed);
+    } else {
+        for (size_t i = 0; i < RAM_SIZE; i++) delta[i] = ram->memory[i] ^ trace->base->memory[i];
+        size = pack(delta, RAM_SIZE, packed);
+    }
+
+    Checkpoint* checkpoint = &trace->checkpoints[trace->checkpoint_count++];
+    checkpoint->icount = icount;
+    checkpoint->input_cursor = trace->input_count;
+    checkpoint->cpu = *cpu;
+    checkpoint->cpu.io = NULL;
+    checkpoint->size = size;
+    checkpoint->data = checked_realloc(NULL, size);
+    memcpy(checkpoint->data, packed, size);
+}
+
+static void restore_checkpoint(Trace* trace, size_t index) {
+    Checkpoint* checkpoint = &trace->checkpoints[index];
+
+    unpack(checkpoint->data, checkpoint->size, trace->ram->memory,
+        index == 0 ? NULL : trace->base->memory);
+
+    trace->cpu = checkpoint->cpu;
+    trace->cpu.io = &trace->io;
+    trace->icount = checkpoint->icount;
+    trace->input_cursor = checkpoint->input_cursor;
+}
+
+static size_t checkpoint_before(const Trace* trace, uint64_t icount) {
+    size_t index = (size_t)(icount / trace->interval);
+    if (index >= trace->checkpoint_count) index = trace->checkpoint_count - 1;
+    return index;
+}
+
+// TRACE
+void trace_init(Trace* trace, uint64_t interval) {
+    memset(trace, 0, sizeof(Trace));
+    trace->interval = interval ? interval : REPLAY_DEFAULT_INTERVAL;
+    trace->base = ram_alloc(1);
+    trace->ram = ram_alloc(1);
+    trace->delta = ram_alloc(1);
+    trace->packed = malloc(REPLAY_PACKED_MAX);
+    if (!trace->base || !trace->ram || !trace->delta || !trace->packed) {
+        fprintf(stderr, "Error: Could not allocate trace memory\n");
+        exit(1);
+    }
+    attach_io(trace, false);
+}
+
+void trace_free(Trace* trace) {
+    for (size_t i = 0; i < trace->checkpoint_count; i++) {
+        free(trace->checkpoints[i].data);
+    }
+    free(trace->checkpoints);
+    free(trace->inputs);
+    ram_free(trace->base, 1);
+    ram_free(trace->ram, 1);
+    ram_free(trace->delta, 1);
+    free(trace->packed);
+    memset(trace, 0, sizeof(Trace));
+}
+
+// RECORD
+void trace_record(Trace* trace, CPU* cpu, RAM* ram, IO* live, uint64_t limit) {
+    uint64_t icount = 0;
+
+    trace->live = live;
+    attach_io(trace, true);
+    cpu->io = &trace->io;
+
+    while (!cpu->halted && icount < limit) {
+        uint64_t offset = icount % trace->interval;
+        if (offset == 0) take_checkpoint(trace, cpu, ram, icount);
+
+        uint64_t budget = trace->interval - offset;
+        if (budget > limit - icount) budget = limit - icount;
+        icount += cpu_run(cpu, ram, budget);
+    }
+
+    if (trace->checkpoint_count == 0) take_checkpoint(trace, cpu, ram, icount);
+
+    trace->end = icount;
+    cpu->io = live;
+    trace->live = NULL;
+    attach_io(trace, false);
+
+    // start replay at the beginning of the recording
+    restore_checkpoint(trace, 0);
+}
+
+// REPLAY
+void replay_seek(Trace* trace, uint64_t icount) {
+    if (icount > trace->end) icount = trace->end;
+
+    // go forward from the current position if no checkpoint is closer
+    size_t index = checkpoint_before(trace, icount);
+    if (icount < trace->icount || trace->checkpoints[index].icount > trace->icount) {
+        restore_checkpoint(trace, index);
+    }
+
+    while (trace->icount < icount && !trace->cpu.halted) {
+        trace->icount += cpu_run(&trace->cpu, trace->ram, icount - trace->icount);
+    }
+}
+
+void replay_step(Trace* trace) {
+    replay_seek(trace, trace->icount + 1);
+}
+
+void replay_step_back(Trace* trace) {
+    if (trace->icount > 0) replay_seek(trace, trace->icount - 1);
+}
+
+static bool is_breakpoint(uint16_t pc, const uint16_t* breakpoints, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (breakpoints[i] == pc) return true;
+    }
+    return false;
+}
+
+bool replay_reverse_continue(Trace* trace, const uint16_t* breakpoints, size_t count) {
+    uint64_t current = trace->icount;
+    if (current == 0) return false;
+
+    // scan one checkpoint interval at a time, newest first
+    for (size_t index = checkpoint_before(trace, current - 1) + 1; index-- > 0;) {
+        restore_checkpoint(trace, index);
+
+        uint64_t end = current;
+        if (index + 1 < trace->checkpoint_count && trace->checkpoints[index + 1].icount < end) {
+            end = trace->checkpoints[index + 1].icount;
+        }
+
+        bool found = false;
+        uint64_t hit = 0;
+        while (trace->icount < end && !trace->cpu.halted) {
+            if (is_breakpoint(trace->cpu.PC, breakpoints, count)) {
+                found = true;
+                hit = trace->icount;
+            }
+            cpu_step(&trace->cpu, trace->ram);
+            trace->icount++;
+        }
+
+        if (found) {
+            replay_seek(trace, hit);
+            return true;
+        }
+    }
+
+    replay_seek(trace, 0);
+    return false;
+}
+
+// FILES
+static bool write_u64(FILE* f, uint64_t value) {
+    return fwrite(&value, sizeof(value), 1, f) == 1;
+}
+
+static bool read_u64(FILE* f, uint64_t* value) {
+    return fread(value, sizeof(*value), 1, f) == 1;
+}
+
+static bool write_cpu(FILE* f, const CPU* cpu) {
+    uint8_t state[4] = { cpu->FLAGS, cpu->halted, cpu->id, cpu->stop };
+
+    return fwrite(cpu->registers, sizeof(cpu->registers), 1, f) == 1 &&
+        fwrite(&cpu->PC, sizeof(cpu->PC), 1, f) == 1 &&
+        fwrite(&cpu->SP, sizeof(cpu->SP), 1, f) == 1 &&
+        fwrite(state, sizeof(state), 1, f) == 1 &&
+        write_u64(f, cpu->cycles);
+}
+
+static bool read_cpu(FILE* f, CPU* cpu) {
+    uint8_t state[4];
+
+    cpu_reset(cpu);
+    if (fread(cpu->registers, sizeof(cpu->registers), 1, f) != 1 ||
+        fread(&cpu->PC, sizeof(cpu->PC), 1, f) != 1 ||
+        fread(&cpu->SP, sizeof(cpu->SP), 1, f) != 1 ||
+        fread(state, sizeof(state), 1, f) != 1 ||
+        !read_u64(f, &cpu->cycles)) {
+        return false;
+    }
+    cpu->FLAGS = state[0];
+    cpu->halted = state[1];
+    cpu->id = state[2];
+    cpu->stop = state[3];
+    return true;
+}
+
+// the checkpoints contain the HCALLs of native bindings, replay needs the same bindings
+static bool write_bindings(FILE* f) {
+    bool ok = write_u64(f, native_binding_count);
+
+    for (size_t i = 0; ok && i < native_binding_count; i++) {
+        const NativeBinding* binding = &native_bindings[i];
+        size_t length = strlen(binding->routine->name);
+        ok = write_u64(f, length) &&
+            fwrite(binding->routine->name, length, 1, f) == 1 &&
+            write_u64(f, binding->address) &&
+            write_u64(f, binding->cycles) &&
+            fwrite(binding->original, sizeof(binding->original), 1, f) == 1;
+    }
+    return ok;
+}
+
+static bool read_bindings(FILE* f) {
+    uint64_t count;
+    if (!read_u64(f, &count) || count > NATIVE_MAX_BINDINGS) return false;
+
+    native_binding_count = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        char name[64];
+        uint64_t length, address, cycles;
+        uint8_t original[ISA_LENGTH_IMM8];
+
+        if (!read_u64(f, &length) || length >= sizeof(name) ||
+            (length > 0 && fread(name, length, 1, f) != 1) ||
+            !read_u64(f, &address) || address >= RAM_SIZE ||
+            !read_u64(f, &cycles) ||
+            fread(original, sizeof(original), 1, f) != 1) {
+            return false;
+        }
+        name[length] = '\0';
+
+        const NativeRoutine* routine = native_find(name);
+        if (!routine) {
+            fprintf(stderr, "Error: The trace uses the unknown native %s\n", name);
+            return false;
+        }
+        if (!native_rebind(routine, (uint16_t)address, cycles, original)) return false;
+    }
+    return true;
+}
+
+bool trace_save(const Trace* trace, const char* filename) {
+    FILE* f = fopen(filename, "wb");
+    if (!f) return false;
+
+    bool ok = fwrite(TRACE_MAGIC, 4, 1, f) == 1 &&
+        write_u64(f, TRACE_VERSION) &&
+        write_u64(f, CPU_REGISTER_SLOTS) &&
+        write_u64(f, trace->interval) &&
+        write_u64(f, trace->end) &&
+        write_u64(f, trace->input_count) &&
+        (trace->input_count == 0 || fwrite(trace->inputs, trace->input_count, 1, f) == 1) &&
+        write_bindings(f) &&
+        write_u64(f, trace->checkpoint_count);
+
+    for (size_t i = 0; ok && i < trace->checkpoint_count; i++) {
+        const Checkpoint* checkpoint = &trace->checkpoints[i];
+        ok = write_u64(f, checkpoint->icount) &&
+            write_u64(f, checkpoint->input_cursor) &&
+            write_cpu(f, &checkpoint->cpu) &&
+            write_u64(f, checkpoint->size) &&
+            fwrite(checkpoint->data, checkpoint->size, 1, f) == 1;
+    }
+
+    return fclose(f) == 0 && ok;
+}
+
+bool trace_load(Trace* trace, const char* filename) {
+    memset(trace, 0, sizeof(Trace));
+
+    FILE* f = fopen(filename, "rb");
+    if (!f) return false;
+
+    char magic[4];
+    uint64_t version, slots, interval, end, input_count, checkpoint_count;
+
+    bool ok = fread(magic, 4, 1, f) == 1 && memcmp(magic, TRACE_MAGIC, 4) == 0 &&
+        read_u64(f, &version) && version == TRACE_VERSION &&
+        read_u64(f, &slots) && slots == CPU_REGISTER_SLOTS &&
+        read_u64(f, &interval) && interval > 0 &&
+        read_u64(f, &end) &&
+        read_u64(f, &input_count);
+
+    if (ok) {
+        trace_init(trace, interval);
+        trace->end = end;
+        trace->input_count = trace->input_capacity = input_count;
+        trace->inputs = checked_realloc(NULL, input_count ? input_count : 1);
+        ok = (input_count == 0 || fread(trace->inputs, input_count, 1, f) == 1) &&
+            read_bindings(f) &&
+            read_u64(f, &checkpoint_count) && checkpoint_count > 0;
+    }
+
+    if (ok) {
+        trace->checkpoints = checked_realloc(NULL, checkpoint_count * sizeof(Checkpoint));
+        trace->checkpoint_capacity = checkpoint_count;
+    }
+
+    for (uint64_t i = 0; ok && i < checkpoint_count; i++) {
+        Checkpoint* checkpoint = &trace->checkpoints[i];
+        uint64_t icount, cursor, size;
+
+        ok = read_u64(f, &icount) && read_u64(f, &cursor) && cursor <= input_count &&
+            read_cpu(f, &checkpoint->cpu) &&
+            read_u64(f, &size) && size <= REPLAY_PACKED_MAX;
+        if (!ok) break;
+
+        checkpoint->icount = icount;
+        checkpoint->input_cursor = cursor;
+        checkpoint->size = size;
+        checkpoint->data = checked_realloc(NULL, size);
+        trace->checkpoint_count++;
+        ok = fread(checkpoint->data, size, 1, f) == 1;
+    }
+    fclose(f);
+
+    if (!ok) {
+        if (trace->base) trace_free(trace);
+        return false;
+    }
+
+    unpack(trace->checkpoints[0].data, trace->checkpoints[0].size, trace->base->memory, NULL);
+    restore_checkpoint(trace, 0);
+    return true;
+}
@@ -0,0 +1,81 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "cpu.h"
+#include "ram.h"
+#include "io.h"
+
+// Deterministic record/replay.
+//
+// Recording logs the only nondeterministic input of a guest (bytes read through IN)
+// and takes a checkpoint of CPU + RAM every `interval` instructions. The RAM of a
+// checkpoint is stored as the XOR against the first checkpoint, PackBits compressed,
+// so unchanged memory costs almost nothing.
+//
+// Replay restores the nearest checkpoint at or before the target and executes
+// forward, feeding the logged inputs back. Reverse execution is built on top of
+// that and never runs more than one checkpoint interval per step.
+
+#define REPLAY_DEFAULT_INTERVAL 100000
+#define REPLAY_PACKED_MAX       (RAM_SIZE + RAM_SIZE / 128 + 1)    // worst case of a compressed RAM
+
+typedef struct {
+    uint64_t icount;        // instructions retired when it was taken
+    size_t input_cursor;    // inputs consumed up to here
+    CPU cpu;
+    uint8_t* data;          // compressed RAM
+    size_t size;
+} Checkpoint;
+
+typedef struct {
+    uint64_t interval;
+
+    uint8_t* inputs;        // every byte the guest read, in order
+    size_t input_count, input_capacity;
+
+    Checkpoint* checkpoints;
+    size_t checkpoint_count, checkpoint_capacity;
+    RAM* base;              // RAM of the first checkpoint
+
+    uint64_t end;           // instructions retired by the recording
+
+    // replay position
+    CPU cpu;
+    RAM* ram;
+    uint64_t icount;
+    size_t input_cursor;
+
+    IO io;                  // IO attached to the CPU while recording or replaying
+    IO* live;               // real devices while recording
+
+    // scratch space of take_checkpoint
+    RAM* delta;
+    uint8_t* packed;        // REPLAY_PACKED_MAX bytes
+} Trace;
+
+void trace_init(Trace* trace, uint64_t interval);
+void trace_free(Trace* trace);
+
+// RECORD
+// runs cpu on ram until it halts or `limit` instructions retired, recording into trace
+void trace_record(Trace* trace, CPU* cpu, RAM* ram, IO* live, uint64_t limit);
+
+// the native bindings (native.h) go into the file too, their HCALLs are part of the
+// recorded RAM. trace_load replaces the current bindings with the recorded ones
+bool trace_save(const Trace* trace, const char* filename);
+bool trace_load(Trace* trace, const char* filename);
+
+// REPLAY
+// positions trace->cpu / trace->ram at the state after `icount` instructions
+void replay_seek(Trace* trace, uint64_t icount);
+void replay_step(Trace* trace);
+void replay_step_back(Trace* trace);
+
+// runs backwards to the last time the PC was on one of the breakpoints,
+// returns false (and goes to instruction 0) if there is none
+bool replay_reverse_continue(Trace* trace, const uint16_t* breakpoints, size_t count);
+
+#endif //REPLAY_H
@@ -1,7 +1,7 @@
 #include "rom.h"
 
-void rom_load(RAM* ram, const uint8_t* program, uint16_t size) {
-    for (uint16_t i = 0; i < size; ++i) {
-        ram_write(ram, i, program[i]);
+void rom_load(RAM* ram, const uint8_t* program, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        ram_write(ram, (uint16_t) i, program[i]);
     }
 }
@@ -2,6 +2,7 @@
 #define ROM_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include "ram.h"
 
 /*
@@ -11,6 +12,6 @@ typedef struct {
 uint8_t rom_read(ROM* rom, uint16_t address);   // read ROM (program)
 */
 
-void rom_load(RAM* ram, const uint8_t* program, uint16_t size);
+void rom_load(RAM* ram, const uint8_t* program, size_t size);
 
 #endif //ROM_H
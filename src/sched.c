@@ -0,0 +1,248 @@
+#define _GNU_SOURCE
+#include "sched.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+typedef struct {
+    Scheduler* sched;
+    size_t index;
+    uint64_t retired;
+    uint64_t slices;
+    uint64_t steals;
+} SchedWorker;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// DEQUE
+static void deque_init(GuestDeque* deque, size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+
+    deque->buffer = calloc(size, sizeof(*deque->buffer));
+    if (!deque->buffer) {
+        fprintf(stderr, "Error: Could not allocate run queue\n");
+        exit(1);
+    }
+    deque->mask = (int64_t)size - 1;
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+}
+
+// only called by the owning worker (or before the workers start)
+static void deque_push(GuestDeque* deque, Guest* guest) {
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+
+    atomic_store_explicit(&deque->buffer[bottom & deque->mask], guest, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+}
+
+// takes the oldest guest, the owner uses it for round robin, thieves for stealing
+static Guest* deque_take(GuestDeque* deque) {
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (top >= bottom) return NULL;
+
+    Guest* guest = atomic_load_explicit(&deque->buffer[top & deque->mask], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+            memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;    // lost the race
+    }
+    return guest;
+}
+
+static int64_t deque_size(GuestDeque* deque) {
+    return atomic_load_explicit(&deque->bottom, memory_order_relaxed) -
+        atomic_load_explicit(&deque->top, memory_order_relaxed);
+}
+
+// IDLE WORKERS
+// idle workers sleep on a futex over `work`, which is bumped whenever a guest is
+// queued that an idle worker could take; wakers only make a syscall if someone sleeps
+static void signal_work(Scheduler* sched, int count) {
+    atomic_fetch_add_explicit(&sched->work, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&sched->sleepers, memory_order_seq_cst) > 0) {
+        syscall(SYS_futex, &sched->work, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+    }
+}
+
+// WORKERS
+static Guest* find_guest(SchedWorker* worker, unsigned* seed) {
+    Scheduler* sched = worker->sched;
+
+    Guest* guest = deque_take(&sched->queues[worker->index]);
+    if (guest || sched->threads == 1) return guest;
+
+    // steal, starting at a random victim
+    size_t start = (size_t)rand_r(seed) % sched->threads;
+    for (size_t i = 0; i < sched->threads; i++) {
+        size_t victim = (start + i) % sched->threads;
+        if (victim == worker->index) continue;
+
+        guest = deque_take(&sched->queues[victim]);
+        if (guest) {
+            worker->steals++;
+            return guest;
+        }
+    }
+    return NULL;
+}
+
+static void* worker_main(void* arg) {
+    SchedWorker* worker = arg;
+    Scheduler* sched = worker->sched;
+    GuestDeque* own = &sched->queues[worker->index];
+    unsigned seed = (unsigned)worker->index * 2654435761u + 1;
+
+    if (sched->pin && !sched_pin_thread(worker->index)) {
+        fprintf(stderr, "Warning: Could not pin worker %zu, its guests may run from remote memory\n",
+            worker->index);
+    }
+
+    while (atomic_load_explicit(&sched->live, memory_order_acquire) > 0) {
+        Guest* guest = find_guest(worker, &seed);
+        if (!guest) {
+            // announce the sleep, then look once more so no wake in between is lost
+            uint32_t work = atomic_load_explicit(&sched->work, memory_order_seq_cst);
+            atomic_fetch_add_explicit(&sched->sleepers, 1, memory_order_seq_cst);
+            guest = find_guest(worker, &seed);
+            if (!guest && atomic_load_explicit(&sched->live, memory_order_seq_cst) > 0) {
+                syscall(SYS_futex, &sched->work, FUTEX_WAIT_PRIVATE, work, NULL, NULL, 0);
+            }
+            atomic_fetch_sub_explicit(&sched->sleepers, 1, memory_order_relaxed);
+            if (!guest) continue;
+        }
+
+        uint64_t executed = cpu_run(&guest->cpu, guest->ram, sched->slice);
+        guest->retired += executed;
+        worker->retired += executed;
+        worker->slices++;
+
+        if (guest->cpu.halted) {
+            // HLT is the only way to park, the last one lets every sleeping worker exit
+            if (atomic_fetch_sub_explicit(&sched->live, 1, memory_order_release) == 1) {
+                signal_work(sched, INT_MAX);
+            }
+        } else {
+            deque_push(own, guest);
+            // more than this worker can run at once, let a sleeping one steal
+            if (deque_size(own) > 1) signal_work(sched, 1);
+        }
+    }
+
+    return NULL;
+}
+
+// SCHEDULER
+void sched_init(Scheduler* sched, size_t threads, uint64_t slice, size_t capacity) {
+    sched->threads = threads ? threads : 1;
+    sched->slice = slice ? slice : SCHED_DEFAULT_SLICE;
+    sched->queues = calloc(sched->threads, sizeof(GuestDeque));
+    if (!sched->queues) {
+        fprintf(stderr, "Error: Could not allocate run queues\n");
+        exit(1);
+    }
+
+    // every guest may end up in the same queue
+    for (size_t i = 0; i < sched->threads; i++) {
+        deque_init(&sched->queues[i], capacity);
+    }
+    sched->pin = false;
+    atomic_init(&sched->live, 0);
+    atomic_init(&sched->next, 0);
+    atomic_init(&sched->work, 0);
+    atomic_init(&sched->sleepers, 0);
+}
+
+void sched_destroy(Scheduler* sched) {
+    for (size_t i = 0; i < sched->threads; i++) {
+        free(sched->queues[i].buffer);
+    }
+    free(sched->queues);
+    sched->queues = NULL;
+}
+
+bool sched_pin_thread(size_t index) {
+    // only CPUs the process may run on (taskset, cgroup cpusets), not every online one
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return false;
+    int count = CPU_COUNT(&allowed);
+    if (count == 0) return false;
+
+    size_t nth = index % (size_t)count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed) || nth-- > 0) continue;
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+    return false;
+}
+
+// wakes are spread round robin, must not race with the owner of the target queue,
+// i.e. call it before sched_run or from the worker running the guest's device
+void sched_wake(Scheduler* sched, Guest* guest) {
+    size_t target = atomic_fetch_add_explicit(&sched->next, 1, memory_order_relaxed) % sched->threads;
+
+    guest->cpu.halted = false;
+    atomic_fetch_add_explicit(&sched->live, 1, memory_order_release);
+    deque_push(&sched->queues[target], guest);
+    signal_work(sched, 1);
+}
+
+void sched_wake_on(Scheduler* sched, Guest* guest, size_t worker) {
+    guest->cpu.halted = false;
+    atomic_fetch_add_explicit(&sched->live, 1, memory_order_release);
+    deque_push(&sched->queues[worker % sched->threads], guest);
+    signal_work(sched, 1);
+}
+
+void sched_run(Scheduler* sched, SchedStats* stats) {
+    SchedWorker* workers = calloc(sched->threads, sizeof(SchedWorker));
+    pthread_t* threads = calloc(sched->threads, sizeof(pthread_t));
+    if (!workers || !threads) {
+        fprintf(stderr, "Error: Could not allocate scheduler workers\n");
+        exit(1);
+    }
+
+    double start = now_seconds();
+
+    for (size_t i = 0; i < sched->threads; i++) {
+        workers[i].sched = sched;
+        workers[i].index = i;
+        if (pthread_create(&threads[i], NULL, worker_main, &workers[i]) != 0) {
+            fprintf(stderr, "Error: Could not start worker thread %zu\n", i);
+            exit(1);
+        }
+    }
+
+    SchedStats total = {0};
+    for (size_t i = 0; i < sched->threads; i++) {
+        pthread_join(threads[i], NULL);
+        total.retired += workers[i].retired;
+        total.slices += workers[i].slices;
+        total.steals += workers[i].steals;
+    }
+    total.seconds = now_seconds() - start;
+
+    if (stats) *stats = total;
+
+    free(threads);
+    free(workers);
+}
@@ -0,0 +1,69 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "cpu.h"
+#include "ram.h"
+
+// Green-thread scheduler: many guests per host thread.
+//
+// A guest is a CPU plus a demand-paged RAM (see ram_alloc). Every worker thread
+// owns a run queue, takes the oldest guest from it, runs it for one time slice
+// with cpu_run and queues it again. Idle workers steal from the other queues and
+// sleep on a futex while there is nothing to steal.
+// Only HLT parks a guest, sched_wake puts a parked guest back into a queue. Scheduled
+// guests have no devices (cpu.io is NULL, IN reads 0), so nothing waits on input and a
+// guest that polls keeps using its time slices.
+
+// one cache line per guest (with 4 registers), guests of different workers never share one
+typedef struct {
+    _Alignas(64) CPU cpu;
+    RAM* ram;
+    uint64_t retired;       // instructions retired over all slices
+    uint32_t index;
+} Guest;
+
+// work-stealing deque, the owner pushes at the bottom, everyone takes from the top
+typedef struct {
+    _Atomic int64_t top;
+    _Atomic int64_t bottom;
+    _Atomic(Guest*)* buffer;
+    int64_t mask;
+} GuestDeque;
+
+typedef struct {
+    uint64_t retired;       // instructions retired
+    uint64_t slices;        // guest time slices (= context switches)
+    uint64_t steals;        // guests taken from another worker's queue
+    double seconds;         // wall clock time
+} SchedStats;
+
+typedef struct {
+    size_t threads;
+    uint64_t slice;         // instructions per time slice
+    bool pin;               // pin worker i to the i-th allowed CPU, see arena.h
+    GuestDeque* queues;     // one per worker
+    _Atomic size_t live;    // guests not parked
+    _Atomic size_t next;    // round robin target for sched_wake
+    _Atomic uint32_t work;  // futex, bumped when queued guests may wake an idle worker
+    _Atomic int sleepers;   // idle workers waiting on `work`
+} Scheduler;
+
+#define SCHED_DEFAULT_SLICE 256
+
+// capacity is the maximum number of guests that are runnable at the same time
+void sched_init(Scheduler* sched, size_t threads, uint64_t slice, size_t capacity);
+void sched_destroy(Scheduler* sched);
+
+void sched_wake(Scheduler* sched, Guest* guest);           // queue a new or parked guest
+void sched_wake_on(Scheduler* sched, Guest* guest, size_t worker);     // same, on a given worker
+void sched_run(Scheduler* sched, SchedStats* stats);       // returns once every guest is parked
+
+// pins the calling thread to the `index`-th CPU (modulo their number) the process is
+// allowed to run on, false if that failed
+bool sched_pin_thread(size_t index);
+
+#endif //SCHED_H
@@ -0,0 +1,225 @@
+#include "smp.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "native.h"
+
+typedef struct SmpWorker SmpWorker;
+
+typedef struct {
+    RAM* ram;
+    SmpWorker* workers;
+    size_t count;
+    uint64_t quantum;
+    pthread_barrier_t barrier;
+    bool done;
+    uint64_t rounds;
+} SmpShared;
+
+// stores of one CPU during a lockstep round, committed at the barrier
+typedef struct {
+    uint8_t memory[RAM_SIZE];           // stored values, valid where dirty
+    uint8_t dirty[RAM_SIZE / 8];
+    uint16_t addresses[RAM_SIZE];       // dirty addresses in the order first stored
+    size_t count;
+} StoreBuffer;
+
+struct SmpWorker {
+    SmpShared* shared;
+    CPU* cpu;
+    uint64_t retired;
+    bool at_serial;         // stopped in front of TAS/CAS/IN/OUT during the parallel phase
+    StoreBuffer* stores;    // lockstep only
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// instructions with effects other CPUs see at once, executed in the serial phase
+static bool is_serial_instruction(uint8_t opcode) {
+    return opcode == TAS || opcode == CAS || opcode == IN || opcode == OUT;
+}
+
+// LOCKSTEP ENGINE
+// in the parallel phase a CPU sees RAM as of the start of the round plus its own stores
+static inline uint8_t lockstep_read(SmpWorker* worker, uint16_t address) {
+    if (worker->stores->dirty[address >> 3] & (1 << (address & 7))) return worker->stores->memory[address];
+    return ram_read(worker->shared->ram, address);
+}
+
+static inline void lockstep_write(SmpWorker* worker, uint16_t address, uint8_t value) {
+    StoreBuffer* stores = worker->stores;
+    uint8_t bit = (uint8_t)(1 << (address & 7));
+
+    if (!(stores->dirty[address >> 3] & bit)) {
+        stores->dirty[address >> 3] |= bit;
+        stores->addresses[stores->count++] = address;
+    }
+    stores->memory[address] = value;
+}
+
+static void lockstep_step(CPU* cpu, SmpWorker* mem);
+
+// TAS/CAS never reach this engine, run_lockstep stops in front of them
+#define EXEC_NAME lockstep_step
+#define EXEC_MEMORY SmpWorker
+#define MEM_READ(mem, addr) lockstep_read(mem, addr)
+#define MEM_FETCH(mem, addr) lockstep_read(mem, addr)
+#define MEM_WRITE(mem, addr, value) lockstep_write(mem, addr, value)
+#define MEM_TEST_AND_SET(mem, addr) ram_test_and_set((mem)->shared->ram, addr)
+#define MEM_COMPARE_EXCHANGE(mem, addr, expected, desired) ram_compare_exchange((mem)->shared->ram, addr, expected, desired)
+#define EXEC_EDGE(mem, from, to) ((void)(from))
+#define EXEC_CALL(mem, from, to) ((void)(from))
+#define EXEC_RET(mem, from, to) ((void)(from))
+#include "cpu_exec.h"
+#undef EXEC_NAME
+#undef EXEC_MEMORY
+#undef MEM_READ
+#undef MEM_FETCH
+#undef MEM_WRITE
+#undef MEM_TEST_AND_SET
+#undef MEM_COMPARE_EXCHANGE
+#undef EXEC_EDGE
+#undef EXEC_CALL
+#undef EXEC_RET
+
+static void* run_free(void* arg) {
+    SmpWorker* worker = arg;
+
+    worker->retired = cpu_run(worker->cpu, worker->shared->ram, UINT64_MAX);
+    return NULL;
+}
+
+static void commit_stores(RAM* ram, StoreBuffer* stores) {
+    for (size_t i = 0; i < stores->count; i++) {
+        uint16_t address = stores->addresses[i];
+        ram_write(ram, address, stores->memory[address]);
+        stores->dirty[address >> 3] = 0;
+    }
+    stores->count = 0;
+}
+
+// serial phase of a lockstep round, executed by worker 0 only: the buffered stores,
+// then the pending TAS/CAS/IN/OUT, both in CPU order
+static void commit_round(SmpShared* shared) {
+    SmpWorker* workers = shared->workers;
+    bool done = true;
+
+    for (size_t i = 0; i < shared->count; i++) {
+        commit_stores(shared->ram, workers[i].stores);
+    }
+    for (size_t i = 0; i < shared->count; i++) {
+        if (workers[i].at_serial) {
+            cpu_step(workers[i].cpu, shared->ram);
+            workers[i].retired++;
+        }
+        if (!workers[i].cpu->halted) done = false;
+    }
+
+    shared->rounds++;
+    shared->done = done;
+}
+
+static void* run_lockstep(void* arg) {
+    SmpWorker* worker = arg;
+    SmpShared* shared = worker->shared;
+    CPU* cpu = worker->cpu;
+
+    for (;;) {
+        // parallel phase, RAM is only read
+        uint64_t executed = 0;
+        worker->at_serial = false;
+
+        while (executed < shared->quantum && !cpu->halted) {
+            if (is_serial_instruction(lockstep_read(worker, cpu->PC))) {
+                worker->at_serial = true;
+                break;
+            }
+            lockstep_step(cpu, worker);
+            executed++;
+        }
+        worker->retired += executed;
+
+        pthread_barrier_wait(&shared->barrier);
+        if (worker == &shared->workers[0]) {
+            commit_round(shared);
+        }
+        pthread_barrier_wait(&shared->barrier);
+
+        if (shared->done) break;
+    }
+
+    return NULL;
+}
+
+void smp_run(CPU* cpus, size_t count, RAM* ram, SmpMode mode, uint64_t quantum, SmpStats* stats) {
+    if (count == 0 || count > SMP_MAX_CPUS) {
+        fprintf(stderr, "Error: SMP needs between 1 and %d CPUs\n", SMP_MAX_CPUS);
+        exit(1);
+    }
+
+    SmpShared shared = {
+        .ram = ram,
+        .count = count,
+        .quantum = quantum ? quantum : SMP_DEFAULT_QUANTUM,
+    };
+
+    SmpWorker* workers = calloc(count, sizeof(SmpWorker));
+    pthread_t* threads = calloc(count, sizeof(pthread_t));
+    if (!workers || !threads) {
+        fprintf(stderr, "Error: Could not allocate SMP workers\n");
+        exit(1);
+    }
+    shared.workers = workers;
+
+    StoreBuffer* stores = NULL;
+    if (mode == SMP_LOCKSTEP) {
+        stores = calloc(count, sizeof(StoreBuffer));
+        if (!stores) {
+            fprintf(stderr, "Error: Could not allocate SMP store buffers\n");
+            exit(1);
+        }
+    }
+
+    if (mode == SMP_LOCKSTEP) pthread_barrier_init(&shared.barrier, NULL, (unsigned)count);
+
+    double start = now_seconds();
+
+    for (size_t i = 0; i < count; i++) {
+        cpus[i].id = (uint8_t)i;
+        cpus[i].SP = (uint16_t)(RAM_SIZE - 1 - i * SMP_STACK_SIZE);
+        workers[i].shared = &shared;
+        workers[i].cpu = &cpus[i];
+        workers[i].stores = stores ? &stores[i] : NULL;
+
+        void* (*entry)(void*) = mode == SMP_LOCKSTEP ? run_lockstep : run_free;
+        if (pthread_create(&threads[i], NULL, entry, &workers[i]) != 0) {
+            fprintf(stderr, "Error: Could not start CPU thread %zu\n", i);
+            exit(1);
+        }
+    }
+
+    uint64_t retired = 0;
+    for (size_t i = 0; i < count; i++) {
+        pthread_join(threads[i], NULL);
+        retired += workers[i].retired;
+    }
+
+    if (stats) {
+        stats->retired = retired;
+        stats->rounds = shared.rounds;
+        stats->seconds = now_seconds() - start;
+    }
+
+    if (mode == SMP_LOCKSTEP) pthread_barrier_destroy(&shared.barrier);
+    free(threads);
+    free(workers);
+    free(stores);
+}
@@ -0,0 +1,42 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "cpu.h"
+#include "ram.h"
+
+// Multi-core guests: N CPUs share one RAM, every CPU runs on its own host thread.
+//
+// SMP_LOCKSTEP is deterministic. CPUs run in parallel for one quantum, but stop in
+// front of TAS/CAS/IN/OUT. During the quantum every CPU reads RAM as it was at the
+// start of the round plus its own stores, which are buffered. At the barrier the
+// stores are committed and then the pending TAS/CAS/IN/OUT executed, both in CPU
+// order, so every run of a guest gives the same result, plain loads and stores
+// included. Stores of other CPUs become visible at the next round.
+//
+// SMP_FREE_RUNNING lets every CPU run flat out, TAS/CAS map onto host atomics.
+//
+// Every CPU gets its own stack at the top of RAM, CPU i starts with
+// SP = RAM_SIZE - 1 - i * SMP_STACK_SIZE, so the stacks take the top
+// count * SMP_STACK_SIZE bytes. A CPU that nests deeper runs into its neighbour's.
+
+typedef enum {
+    SMP_LOCKSTEP,
+    SMP_FREE_RUNNING,
+} SmpMode;
+
+#define SMP_MAX_CPUS        256
+#define SMP_DEFAULT_QUANTUM 1000
+#define SMP_STACK_SIZE      128         // bytes of stack per CPU
+
+typedef struct {
+    uint64_t retired;               // instructions retired by all CPUs
+    uint64_t rounds;                // lockstep rounds (0 when free running)
+    double seconds;                 // wall clock time
+} SmpStats;
+
+// runs until every CPU is halted, cpus[i].id is set to i and cpus[i].SP to its stack
+void smp_run(CPU* cpus, size_t count, RAM* ram, SmpMode mode, uint64_t quantum, SmpStats* stats);
+
+#endif //SMP_H
@@ -0,0 +1,82 @@
+#include "snapshot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void mark_dirty(Snapshot* snapshot, size_t page) {
+    if (snapshot->dirty[page]) return;
+
+    snapshot->dirty[page] = 1;
+    snapshot->dirty_pages[snapshot->dirty_count++] = (uint16_t)page;
+    snapshot->bus->pages[page] &= (uint8_t)~BUS_TRAP_WRITE;
+}
+
+// bus trap, first write to a clean page
+static void dirty_trap(void* ctx, uint16_t address, uint8_t value, bool write) {
+    (void)value;
+    if (write) mark_dirty(ctx, address >> BUS_PAGE_SHIFT);
+}
+
+void snapshot_init(Snapshot* snapshot, Bus* bus) {
+    memset(snapshot, 0, sizeof(Snapshot));
+    snapshot->bus = bus;
+    snapshot->own_image = ram_alloc(1);
+    snapshot->image = snapshot->own_image;
+    if (!snapshot->own_image) {
+        fprintf(stderr, "Error: Could not allocate snapshot memory\n");
+        exit(1);
+    }
+    bus_set_trap(bus, dirty_trap, snapshot);
+}
+
+void snapshot_free(Snapshot* snapshot) {
+    ram_free(snapshot->own_image, 1);
+    snapshot->own_image = NULL;
+    snapshot->image = NULL;
+}
+
+static void arm(Snapshot* snapshot) {
+    memset(snapshot->dirty, 0, sizeof(snapshot->dirty));
+    snapshot->dirty_count = 0;
+
+    for (size_t page = 0; page < BUS_PAGES; page++) {
+        snapshot->bus->pages[page] |= BUS_TRAP_WRITE;
+    }
+}
+
+void snapshot_take(Snapshot* snapshot) {
+    memcpy(snapshot->own_image, snapshot->bus->ram, sizeof(RAM));
+    snapshot->image = snapshot->own_image;
+    arm(snapshot);
+}
+
+void snapshot_load(Snapshot* snapshot, const RAM* image) {
+    memcpy(snapshot->bus->ram, image, sizeof(RAM));
+    snapshot->image = image;
+    arm(snapshot);
+}
+
+void snapshot_restore(Snapshot* snapshot) {
+    RAM* ram = snapshot->bus->ram;
+
+    for (size_t i = 0; i < snapshot->dirty_count; i++) {
+        size_t page = snapshot->dirty_pages[i];
+        size_t offset = page << BUS_PAGE_SHIFT;
+
+        memcpy(&ram->memory[offset], &snapshot->image->memory[offset], BUS_PAGE_SIZE);
+        snapshot->dirty[page] = 0;
+        snapshot->bus->pages[page] |= BUS_TRAP_WRITE;
+    }
+    snapshot->dirty_count = 0;
+}
+
+void snapshot_touch(Snapshot* snapshot, uint16_t address, size_t length) {
+    if (length == 0) return;
+
+    size_t first = address >> BUS_PAGE_SHIFT;
+    size_t last = ((size_t)address + length - 1) >> BUS_PAGE_SHIFT;
+    for (size_t page = first; page <= last && page < BUS_PAGES; page++) {
+        mark_dirty(snapshot, page);
+    }
+}
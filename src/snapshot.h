@@ -0,0 +1,36 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "bus.h"
+#include "ram.h"
+
+// Page-granular RAM snapshot.
+//
+// snapshot_take copies the RAM behind a bus and arms a write trap on every page.
+// The first write to a page marks it dirty and disarms its trap, so each page costs
+// one trap per run. snapshot_restore copies back only the dirty pages.
+// The snapshot owns the trap of its bus.
+
+typedef struct {
+    Bus* bus;
+    const RAM* image;                   // RAM at the time of the snapshot
+    RAM* own_image;                     // copy made by snapshot_take
+    uint8_t dirty[BUS_PAGES];
+    uint16_t dirty_pages[BUS_PAGES];
+    size_t dirty_count;
+} Snapshot;
+
+void snapshot_init(Snapshot* snapshot, Bus* bus);
+void snapshot_free(Snapshot* snapshot);
+
+void snapshot_take(Snapshot* snapshot);
+// copies `image` into RAM and uses it as the snapshot, the caller keeps it alive
+void snapshot_load(Snapshot* snapshot, const RAM* image);
+void snapshot_restore(Snapshot* snapshot);
+
+// marks a range dirty that the host is about to write without going through the bus
+void snapshot_touch(Snapshot* snapshot, uint16_t address, size_t length);
+
+#endif //SNAPSHOT_H
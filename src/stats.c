@@ -0,0 +1,147 @@
+#include "stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// segments outlive their emulator, one whose writer exited may be taken over
+static bool owner_exited(const char* name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return errno == ENOENT;
+
+    // shorter than a segment: its creator died before the ftruncate, mapping it would SIGBUS
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(StatsSegment)) {
+        close(fd);
+        return true;
+    }
+
+    StatsSegment copy;
+    bool exited = false;
+    void* memory = mmap(NULL, sizeof(StatsSegment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) return false;
+
+    if (stats_segment_read(memory, &copy, 1000) && copy.magic == STATS_MAGIC) {
+        exited = kill((pid_t)copy.pid, 0) != 0 && errno == ESRCH;
+    }
+    munmap(memory, sizeof(StatsSegment));
+    return exited;
+}
+
+bool stats_open(Stats* stats, const char* name, const char* program, uint64_t interval) {
+    memset(stats, 0, sizeof(Stats));
+    snprintf(stats->name, sizeof(stats->name), STATS_PREFIX "%s", name);
+    stats->interval = interval ? interval : STATS_DEFAULT_INTERVAL;
+    stats->next_update = stats->interval;
+
+    // never truncate the segment of a running emulator under its readers
+    int fd = shm_open(stats->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 && errno == EEXIST && owner_exited(stats->name)) {
+        shm_unlink(stats->name);
+        fd = shm_open(stats->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if (fd < 0) return false;
+
+    if (ftruncate(fd, sizeof(StatsSegment)) != 0) {
+        close(fd);
+        shm_unlink(stats->name);
+        return false;
+    }
+    void* memory = mmap(NULL, sizeof(StatsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        shm_unlink(stats->name);
+        return false;
+    }
+
+    // a fresh segment is all zeroes, so readers see an even sequence and no magic yet
+    StatsSegment* segment = memory;
+    stats_segment_begin(segment);
+    segment->version = STATS_VERSION;
+    segment->pid = (uint32_t)getpid();
+    snprintf(segment->program, sizeof(segment->program), "%s", program);
+    segment->magic = STATS_MAGIC;
+    stats_segment_end(segment);
+
+    stats->segment = segment;
+    stats->start = stats->last_time = now_seconds();
+    return true;
+}
+
+void stats_close(Stats* stats) {
+    if (!stats->segment) return;
+
+    munmap(stats->segment, sizeof(StatsSegment));
+    stats->segment = NULL;
+}
+
+void stats_publish(Stats* stats, const CPU* cpu) {
+    StatsSegment* segment = stats->segment;
+    double now = now_seconds();
+    double elapsed = now - stats->last_time;
+
+    stats_segment_begin(segment);
+    segment->instructions = stats->instructions;
+    segment->cycles = cpu->cycles;
+    segment->ips = elapsed > 0 ? (double)(stats->instructions - stats->last_instructions) / elapsed : 0;
+    segment->uptime = now - stats->start;
+    segment->pc = cpu->PC;
+    segment->halted = cpu->halted;
+    segment->stop = cpu->stop;
+    segment->updates++;
+    if (cpu->io) {
+        segment->io_in = cpu->io->bytes_in;
+        segment->io_out = cpu->io->bytes_out;
+    }
+    memcpy(segment->opcode_samples, stats->opcode_samples, sizeof(segment->opcode_samples));
+    stats_segment_end(segment);
+
+    stats->last_time = now;
+    stats->last_instructions = stats->instructions;
+}
+
+void stats_update(Stats* stats, const CPU* cpu, RAM* ram, uint64_t retired) {
+    stats->instructions += retired;
+    stats->opcode_samples[ram_read(ram, cpu->PC)]++;
+
+    if (stats->instructions >= stats->next_update) {
+        stats_publish(stats, cpu);
+        stats->next_update = stats->instructions + stats->interval;
+    }
+}
+
+void stats_finish(Stats* stats, const CPU* cpu) {
+    if (cpu->halted && cpu->stop < STATS_STOP_REASONS) {
+        stats_segment_begin(stats->segment);
+        stats->segment->stops[cpu->stop]++;
+        stats_segment_end(stats->segment);
+    }
+    stats_publish(stats, cpu);
+}
+
+uint64_t stats_run(Stats* stats, CPU* cpu, RAM* ram, uint64_t budget) {
+    uint64_t executed = 0;
+
+    while (executed < budget && !cpu->halted) {
+        uint64_t chunk = budget - executed < STATS_SAMPLE_PERIOD ? budget - executed : STATS_SAMPLE_PERIOD;
+        uint64_t ran = cpu_run(cpu, ram, chunk);
+        executed += ran;
+        stats_update(stats, cpu, ram, ran);
+    }
+
+    stats_finish(stats, cpu);
+    return executed;
+}
@@ -0,0 +1,51 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cpu.h"
+#include "stats_segment.h"
+
+// Live statistics of a running CPU in a named shared-memory segment
+// (/dev/shm/emu.<name>), read with tools/stats.
+//
+// stats_run executes in chunks of STATS_SAMPLE_PERIOD instructions and samples the
+// opcode at PC between them, so the opcode mix is one sample per chunk, not a count
+// of every instruction. The segment is only written every `interval` instructions,
+// the interpreter loop itself is untouched. Run loops of their own (pace_run) call
+// stats_update between their batches instead.
+
+#define STATS_SAMPLE_PERIOD     1024
+#define STATS_DEFAULT_INTERVAL  (1 << 20)   // instructions between updates
+
+typedef struct {
+    StatsSegment* segment;
+    char name[128];
+    uint64_t interval;
+
+    double start;
+    double last_time;
+    uint64_t last_instructions;
+    uint64_t instructions;
+    uint64_t next_update;
+    uint64_t opcode_samples[256];
+} Stats;
+
+// fails if the segment belongs to an emulator that is still running
+bool stats_open(Stats* stats, const char* name, const char* program, uint64_t interval);
+// the segment outlives the process so the final state can still be read,
+// estat --clean removes segments of exited emulators
+void stats_close(Stats* stats);
+
+void stats_publish(Stats* stats, const CPU* cpu);
+
+// `retired` instructions ran since the last call: samples the opcode at PC and
+// publishes once `interval` instructions have passed
+void stats_update(Stats* stats, const CPU* cpu, RAM* ram, uint64_t retired);
+// counts the stop reason and publishes the final state
+void stats_finish(Stats* stats, const CPU* cpu);
+
+// like cpu_run, publishes as it goes and once more at the end
+uint64_t stats_run(Stats* stats, CPU* cpu, RAM* ram, uint64_t budget);
+
+#endif //STATS_H
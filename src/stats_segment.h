@@ -0,0 +1,61 @@
+#ifndef STATS_SEGMENT_H
+#define STATS_SEGMENT_H
+
+#include <stdint.h>
+
+// Layout of the shared-memory statistics segment, shared by the emulator (writer,
+// see stats.h) and tools/stats (reader). Plain C, also included from C++.
+//
+// The segment is a seqlock: the writer makes `sequence` odd, updates the fields and
+// makes it even again. Readers copy the segment and retry if `sequence` was odd or
+// changed in between.
+
+#define STATS_MAGIC         0x54534D45u     // "EMST"
+#define STATS_VERSION       1
+#define STATS_PREFIX        "/emu."         // segment name is STATS_PREFIX <name>
+#define STATS_STOP_REASONS  8               // indexed by CpuStop
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sequence;
+    uint32_t pid;
+    char program[64];
+
+    uint64_t instructions;          // retired
+    uint64_t cycles;
+    double ips;                     // instructions per second since the previous update
+    double uptime;                  // seconds since the CPU started
+    uint16_t pc;
+    uint8_t halted;
+    uint8_t stop;                   // CpuStop of the current stop
+    uint32_t updates;
+
+    uint64_t stops[STATS_STOP_REASONS];     // stops per reason
+    uint64_t io_in, io_out;                 // device bytes
+    uint64_t opcode_samples[256];           // opcode at PC, sampled
+} StatsSegment;
+
+static inline void stats_segment_begin(StatsSegment* segment) {
+    __atomic_store_n(&segment->sequence, segment->sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void stats_segment_end(StatsSegment* segment) {
+    __atomic_store_n(&segment->sequence, segment->sequence + 1, __ATOMIC_RELEASE);
+}
+
+// consistent copy of the segment, 0 if the writer did not let go after `tries` attempts
+static inline int stats_segment_read(const StatsSegment* segment, StatsSegment* copy, int tries) {
+    for (int i = 0; i < tries; i++) {
+        uint32_t before = __atomic_load_n(&segment->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1) continue;
+
+        *copy = *segment;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&segment->sequence, __ATOMIC_RELAXED) == before) return 1;
+    }
+    return 0;
+}
+
+#endif //STATS_SEGMENT_H
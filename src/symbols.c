@@ -0,0 +1,72 @@
+#include "symbols.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int compare_symbols(const void* a, const void* b) {
+    const Symbol* left = a;
+    const Symbol* right = b;
+    return (int)left->address - (int)right->address;
+}
+
+bool symbols_load(SymbolTable* table, const char* map_file) {
+    table->symbols = NULL;
+    table->count = 0;
+
+    FILE* file = fopen(map_file, "r");
+    if (!file) return false;
+
+    char line[256];
+    size_t capacity = 0;
+    while (fgets(line, sizeof(line), file)) {
+        unsigned int address;
+        char name[64];
+        if (sscanf(line, "%x %63s", &address, name) != 2 || address > 0xFFFF) continue;
+
+        if (table->count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            Symbol* symbols = realloc(table->symbols, capacity * sizeof(Symbol));
+            if (!symbols) break;
+            table->symbols = symbols;
+        }
+        Symbol* symbol = &table->symbols[table->count++];
+        symbol->address = (uint16_t)address;
+        snprintf(symbol->name, sizeof(symbol->name), "%s", name);
+    }
+    fclose(file);
+
+    qsort(table->symbols, table->count, sizeof(Symbol), compare_symbols);
+    return true;
+}
+
+void symbols_free(SymbolTable* table) {
+    free(table->symbols);
+    table->symbols = NULL;
+    table->count = 0;
+}
+
+const Symbol* symbols_find(const SymbolTable* table, const char* name) {
+    for (size_t i = 0; i < table->count; i++) {
+        if (strcmp(table->symbols[i].name, name) == 0) return &table->symbols[i];
+    }
+    return NULL;
+}
+
+void symbols_format(const SymbolTable* table, uint16_t address, char* out, size_t size) {
+    const Symbol* best = NULL;
+    size_t low = 0, high = table ? table->count : 0;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (table->symbols[mid].address <= address) {
+            best = &table->symbols[mid];
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    if (!best) snprintf(out, size, "0x%04x", address);
+    else if (best->address == address) snprintf(out, size, "%s", best->name);
+    else snprintf(out, size, "%s+0x%x", best->name, address - best->address);
+}
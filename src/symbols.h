@@ -0,0 +1,31 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Guest labels from a map file written by easm --map, eld or ebuild,
+// one "0x%04x NAME file g|l" line per label.
+
+typedef struct {
+    uint16_t address;
+    char name[64];
+} Symbol;
+
+typedef struct {
+    Symbol* symbols;            // sorted by address
+    size_t count;
+} SymbolTable;
+
+bool symbols_load(SymbolTable* table, const char* map_file);
+void symbols_free(SymbolTable* table);
+
+// NULL if there is no label called `name`
+const Symbol* symbols_find(const SymbolTable* table, const char* name);
+
+// name of the label at `address`, of the closest one before it plus an offset
+// ("LOOP+0x3") or the plain address if there is none, `table` may be NULL
+void symbols_format(const SymbolTable* table, uint16_t address, char* out, size_t size);
+
+#endif //SYMBOLS_H
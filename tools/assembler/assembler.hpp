@@ -0,0 +1,502 @@
+/**
+ * The assembler, object file format and linker shared by easm, eld and ebuild.
+ *
+ * assemble() turns the lines of one source file into a relocatable Object: its code
+ * starting at offset 0, the labels it defines and one relocation per operand that
+ * names a label. Labels are local to their file unless listed in a GLOBAL directive
+ * (GLOBAL MAIN, HELPER); names that are not defined in the file are external and
+ * must be a GLOBAL of another file at link time. DB emits data bytes as they are
+ * (DB 0x06, 9, LABEL), a label operand contributes its low byte.
+ *
+ * link() places the objects one after the other, starting at 0x0000 where the emulator
+ * loads and starts a program, and patches every relocation with the final address of
+ * its symbol.
+ */
+
+#ifndef EASM_ASSEMBLER_HPP
+#define EASM_ASSEMBLER_HPP
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <cstdint>
+#include <cctype>
+#include <cstdio>
+#include <algorithm>
+
+#include "../../src/config.h"
+#include "../../src/isa.h"
+
+// --- Helper Maps ---
+// Map mnemonics (text) to their opcode and operand format, generated from src/isa.def
+struct InstructionInfo {
+    uint8_t opcode;
+    OperandKind operands;
+    uint8_t length;         // bytes
+};
+
+inline std::map<std::string, InstructionInfo> make_instructions() {
+    std::map<std::string, InstructionInfo> instructions;
+#define ISA(name, opcode, operands, cycles, assembler) \
+    if (assembler) instructions[#name] = {opcode, OPERANDS_##operands, ISA_LENGTH_##operands};
+#include "../../src/isa.def"
+#undef ISA
+    return instructions;
+}
+
+inline std::map<std::string, InstructionInfo> INSTRUCTIONS = make_instructions();
+
+// Map register names (text) to their byte value
+// Generated from CPU_NUM_REGISTERS so easm and the emulator agree on the register file:
+// A, B, C, D plus R0 .. R<n-1> as aliases for every register
+inline std::map<std::string, uint8_t> make_registers() {
+    std::map<std::string, uint8_t> registers = {
+        {"A", 0x00}, {"B", 0x01}, {"C", 0x02}, {"D", 0x03}
+    };
+    for (int i = 0; i < CPU_NUM_REGISTERS; i++) {
+        registers["R" + std::to_string(i)] = (uint8_t)i;
+    }
+    return registers;
+}
+
+inline std::map<std::string, uint8_t> REGISTERS = make_registers();
+
+// --- Object Files ---
+struct Symbol {
+    uint16_t value;         // offset in the code of its object
+    bool global;
+};
+
+struct Relocation {
+    uint16_t offset;        // of the patched bytes in the code
+    uint8_t size;           // 2: 16-bit address, high byte first; 1: low byte only
+    std::string symbol;
+};
+
+struct Object {
+    std::vector<uint8_t> code;
+    std::map<std::string, Symbol> symbols;
+    std::vector<Relocation> relocations;
+};
+
+// Bump when the object format or the generated code changes, ebuild caches by it
+constexpr uint32_t OBJECT_VERSION = 1;
+
+// --- Helper Functions ---
+
+// Converts a string to uppercase
+inline std::string to_upper(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](unsigned char c){ return std::toupper(c); });
+    return s;
+}
+// Trims whitespace (space, tab, newline, carriage return) from start and end
+inline std::string trim(const std::string& str) {
+    size_t first = str.find_first_not_of(" \t\n\r");
+    if (std::string::npos == first) {
+        return "";
+    }
+    size_t last = str.find_last_not_of(" \t\n\r");
+    return str.substr(first, (last - first + 1));
+}
+
+// Splits a line into tokens, handling commas and whitespace
+inline std::vector<std::string> split_line(const std::string& line) {
+    std::vector<std::string> tokens;
+    std::string token;
+    for (char c : line) {
+        // Treat all whitespace and commas as delimiters
+        if (c == ' ' || c == '\t' || c == ',' || c == '\n' || c == '\r') {
+            if (!token.empty()) {
+                tokens.push_back(token);
+                token.clear();
+            }
+        } else {
+            token += c;
+        }
+    }
+    if (!token.empty()) {
+        tokens.push_back(token);
+    }
+    return tokens;
+}
+
+// Parses a value string (e.g., "5", "0x1A", or "my_label")
+// Labels are not resolved here: they get a placeholder and a relocation of `size` bytes
+// at the current end of the code.
+inline uint16_t parse_operand(const std::string& token, Object& object, uint8_t size) {
+    std::string upper_token = to_upper(token);
+
+    // 1. Is it a register? (Should be handled by caller, but good to check)
+    if (REGISTERS.count(upper_token)) {
+        // This is an error, parse_operand should be for values/addresses
+        // But for simplicity, we'll let it pass.
+        return REGISTERS.at(upper_token);
+    }
+
+    // 2. Is it a number?
+    if (std::isdigit((unsigned char)upper_token[0])) {
+        try {
+            size_t used = 0;
+            unsigned long value;
+            if (upper_token.rfind("0X", 0) == 0) {
+                // Hex number (e.g., "0x1A")
+                value = std::stoul(upper_token, &used, 16);
+            } else {
+                // Decimal number (e.g., "26")
+                value = std::stoul(upper_token, &used, 10);
+            }
+            if (used == upper_token.size()) return (uint16_t)value;
+        } catch (const std::exception& e) {
+        }
+        throw std::runtime_error("Invalid operand: " + token);
+    }
+
+    // 3. Then it is a label, resolved by the linker
+    object.relocations.push_back({(uint16_t)object.code.size(), size, upper_token});
+    return 0;
+}
+
+// --- Main Assembler Logic ---
+
+// Assembles one source file, throws std::runtime_error with the offending line
+inline Object assemble(const std::vector<std::string>& lines) {
+    Object object;
+
+    // --- PASS 1 (Label Pass) ---
+    // This pass finds all labels and calculates their offset in the code.
+    std::vector<std::string> globals;
+    uint16_t current_address = 0;
+
+    for (const std::string& line_raw : lines) {
+        // Clean up the line: remove comments and trim whitespace
+        std::string line = trim(line_raw.substr(0, line_raw.find(';')));
+        if (line.empty()) continue;
+
+        // Check for a label (e.g., "LOOP:")
+        size_t label_pos = line.find(':');
+        if (label_pos != std::string::npos) {
+            std::string label = to_upper(trim(line.substr(0, label_pos)));
+            if (object.symbols.count(label)) {
+                throw std::runtime_error("Duplicate label '" + label + "'");
+            }
+            // operands are looked up as registers first, such a label could never be used
+            if (REGISTERS.count(label)) {
+                throw std::runtime_error("Label '" + label + "' is a register name");
+            }
+            object.symbols[label] = {current_address, false};
+            line = trim(line.substr(label_pos + 1)); // Remove label from line
+        }
+
+        if (line.empty()) continue;
+
+        // Parse instruction to find its size
+        std::vector<std::string> tokens = split_line(line);
+        std::string mnemonic = to_upper(tokens[0]);
+
+        if (mnemonic == "GLOBAL") {
+            for (size_t i = 1; i < tokens.size(); i++) globals.push_back(to_upper(tokens[i]));
+        } else if (mnemonic == "DB") {
+            current_address += (uint16_t)(tokens.size() - 1);
+        } else if (INSTRUCTIONS.count(mnemonic)) {
+            current_address += INSTRUCTIONS.at(mnemonic).length;
+        } else {
+            throw std::runtime_error("Unknown mnemonic '" + mnemonic + "'");
+        }
+    }
+
+    for (const std::string& name : globals) {
+        if (!object.symbols.count(name)) {
+            throw std::runtime_error("GLOBAL '" + name + "' is not defined in this file");
+        }
+        object.symbols[name].global = true;
+    }
+
+    // --- PASS 2 (Code Generation Pass) ---
+    // This pass generates the actual machine code.
+    std::vector<uint8_t>& machine_code = object.code;
+
+    for (const std::string& line_raw : lines) {
+        // Clean up the line: remove comments and trim whitespace
+        std::string line = trim(line_raw.substr(0, line_raw.find(';')));
+        if (line.empty()) continue;
+
+        // Remove label (if any)
+        size_t label_pos = line.find(':');
+        if (label_pos != std::string::npos) {
+            line = trim(line.substr(label_pos + 1));
+        }
+
+        if (line.empty()) continue;
+
+        std::vector<std::string> tokens = split_line(line);
+        std::string mnemonic = to_upper(tokens[0]);
+        if (mnemonic == "GLOBAL") continue;
+
+        try {
+            if (mnemonic == "DB") {
+                for (size_t i = 1; i < tokens.size(); i++) {
+                    uint16_t value = parse_operand(tokens[i], object, 1);
+                    if (value > 0xFF) throw std::runtime_error("Byte out of range: " + tokens[i]);
+                    machine_code.push_back((uint8_t)value);
+                }
+                continue;
+            }
+
+            // Write the opcode
+            const InstructionInfo& info = INSTRUCTIONS.at(mnemonic);
+            machine_code.push_back(info.opcode);
+
+            // --- Handle Operands (This is the core logic) ---
+            switch (info.operands) {
+                case OPERANDS_NONE:
+                    // No operands to add
+                    break;
+
+                case OPERANDS_IMM8: {
+                    // LDI <value>, IN <port>, OUT <port>
+                    uint16_t value = parse_operand(tokens.at(1), object, 1);
+                    machine_code.push_back((uint8_t)value);
+                    break;
+                }
+
+                case OPERANDS_REG:
+                    // PUSH <register>
+                    machine_code.push_back(REGISTERS.at(to_upper(tokens.at(1))));
+                    break;
+
+                case OPERANDS_REG_REG:
+                    // MOV <reg_to>, <reg_from>
+                    machine_code.push_back(REGISTERS.at(to_upper(tokens.at(1))));
+                    machine_code.push_back(REGISTERS.at(to_upper(tokens.at(2))));
+                    break;
+
+                case OPERANDS_ADDR: {
+                    // JMP <address>, LDA <address>, CALL <address>, etc.
+                    uint16_t addr = parse_operand(tokens.at(1), object, 2);
+                    // Write the high byte first
+                    machine_code.push_back((uint8_t)(addr >> 8));
+                    // Write the low byte second
+                    machine_code.push_back((uint8_t)(addr & 0xFF));
+                    break;
+                }
+            }
+
+        } catch (const std::exception& e) {
+            throw std::runtime_error("on line: " + line_raw + "\nDetails: " + e.what());
+        }
+    }
+
+    return object;
+}
+
+// Reads a source file into lines
+inline std::vector<std::string> read_lines(const std::string& filename) {
+    std::ifstream infile(filename);
+    if (!infile) {
+        throw std::runtime_error("Cannot open input file " + filename);
+    }
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(infile, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+// --- Object File I/O ---
+// "EOBJ", version, code, symbols, relocations; integers little endian,
+// strings prefixed with their 16-bit length
+
+inline void put_u16(std::string& out, uint16_t value) {
+    out += (char)(value & 0xFF);
+    out += (char)(value >> 8);
+}
+
+inline void put_u32(std::string& out, uint32_t value) {
+    put_u16(out, (uint16_t)(value & 0xFFFF));
+    put_u16(out, (uint16_t)(value >> 16));
+}
+
+inline void put_string(std::string& out, const std::string& s) {
+    put_u16(out, (uint16_t)s.size());
+    out += s;
+}
+
+inline std::string serialize_object(const Object& object) {
+    std::string out = "EOBJ";
+    put_u32(out, OBJECT_VERSION);
+
+    put_u32(out, (uint32_t)object.code.size());
+    out.append(object.code.begin(), object.code.end());
+
+    put_u32(out, (uint32_t)object.symbols.size());
+    for (const auto& [name, symbol] : object.symbols) {
+        put_string(out, name);
+        put_u16(out, symbol.value);
+        out += (char)symbol.global;
+    }
+
+    put_u32(out, (uint32_t)object.relocations.size());
+    for (const Relocation& reloc : object.relocations) {
+        put_u16(out, reloc.offset);
+        out += (char)reloc.size;
+        put_string(out, reloc.symbol);
+    }
+    return out;
+}
+
+struct ObjectReader {
+    const std::string& data;
+    size_t pos = 0;
+
+    uint8_t u8() {
+        if (pos >= data.size()) throw std::runtime_error("Truncated object file");
+        return (uint8_t)data[pos++];
+    }
+    uint16_t u16() { uint16_t low = u8(); return (uint16_t)(low | u8() << 8); }
+    uint32_t u32() { uint32_t low = u16(); return low | (uint32_t)u16() << 16; }
+    std::string bytes(size_t count) {
+        if (data.size() - pos < count) throw std::runtime_error("Truncated object file");
+        std::string s = data.substr(pos, count);
+        pos += count;
+        return s;
+    }
+    std::string string() { return bytes(u16()); }
+};
+
+inline Object deserialize_object(const std::string& data) {
+    ObjectReader in{data};
+    Object object;
+
+    if (in.bytes(4) != "EOBJ") throw std::runtime_error("Not an object file");
+    if (in.u32() != OBJECT_VERSION) throw std::runtime_error("Unsupported object file version");
+
+    std::string code = in.bytes(in.u32());
+    object.code.assign(code.begin(), code.end());
+
+    for (uint32_t i = 0, count = in.u32(); i < count; i++) {
+        std::string name = in.string();
+        uint16_t value = in.u16();
+        object.symbols[name] = {value, in.u8() != 0};
+    }
+    for (uint32_t i = 0, count = in.u32(); i < count; i++) {
+        Relocation reloc;
+        reloc.offset = in.u16();
+        reloc.size = in.u8();
+        reloc.symbol = in.string();
+        if (reloc.size < 1 || reloc.size > 2 || (size_t)reloc.offset + reloc.size > object.code.size()) {
+            throw std::runtime_error("Bad relocation in object file");
+        }
+        object.relocations.push_back(reloc);
+    }
+    return object;
+}
+
+inline std::string read_file(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open " + filename);
+    std::ostringstream data;
+    data << in.rdbuf();
+    return data.str();
+}
+
+inline void write_file(const std::string& filename, const std::string& data) {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) throw std::runtime_error("Cannot open output file " + filename);
+    out.write(data.data(), data.size());
+    if (!out) throw std::runtime_error("Cannot write " + filename);
+}
+
+// --- Linker ---
+struct LinkInput {
+    std::string name;       // file name, for messages and the map
+    Object object;
+};
+
+struct MapEntry {
+    uint16_t address;
+    std::string symbol;
+    std::string file;
+    bool global;
+};
+
+// Links the objects into one image loaded at 0x0000, throws on undefined or duplicate symbols
+inline std::vector<uint8_t> link(const std::vector<LinkInput>& inputs, std::vector<MapEntry>* map = nullptr) {
+    // place the objects
+    std::vector<uint32_t> bases;
+    uint32_t address = 0;
+    for (const LinkInput& input : inputs) {
+        bases.push_back(address);
+        address += (uint32_t)input.object.code.size();
+    }
+    if (address > 0x10000) {
+        throw std::runtime_error("Image does not fit into 64 KiB (" + std::to_string(address) + " bytes)");
+    }
+
+    // global symbol table
+    std::map<std::string, std::pair<uint16_t, size_t>> globals;   // address, defining input
+    for (size_t i = 0; i < inputs.size(); i++) {
+        for (const auto& [name, symbol] : inputs[i].object.symbols) {
+            if (map) map->push_back({(uint16_t)(bases[i] + symbol.value), name, inputs[i].name, symbol.global});
+            if (!symbol.global) continue;
+
+            if (globals.count(name)) {
+                throw std::runtime_error("Duplicate symbol '" + name + "' in " + inputs[i].name +
+                    " and " + inputs[globals[name].second].name);
+            }
+            globals[name] = {(uint16_t)(bases[i] + symbol.value), i};
+        }
+    }
+
+    // copy and patch
+    std::vector<uint8_t> image;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        const Object& object = inputs[i].object;
+        size_t start = image.size();
+        image.insert(image.end(), object.code.begin(), object.code.end());
+
+        for (const Relocation& reloc : object.relocations) {
+            uint16_t value;
+            auto local = object.symbols.find(reloc.symbol);
+            if (local != object.symbols.end()) {
+                value = (uint16_t)(bases[i] + local->second.value);
+            } else if (globals.count(reloc.symbol)) {
+                value = globals[reloc.symbol].first;
+            } else {
+                throw std::runtime_error("Undefined symbol '" + reloc.symbol + "' in " + inputs[i].name);
+            }
+
+            if (reloc.size == 2) {
+                image[start + reloc.offset] = (uint8_t)(value >> 8);
+                image[start + reloc.offset + 1] = (uint8_t)(value & 0xFF);
+            } else {
+                image[start + reloc.offset] = (uint8_t)(value & 0xFF);
+            }
+        }
+    }
+
+    if (map) {
+        std::stable_sort(map->begin(), map->end(), [](const MapEntry& a, const MapEntry& b) {
+            return a.address < b.address;
+        });
+    }
+    return image;
+}
+
+// One line per symbol: address, name, file and g(lobal) or l(ocal)
+inline std::string format_map(const std::vector<MapEntry>& map) {
+    std::ostringstream out;
+    for (const MapEntry& entry : map) {
+        char address[8];
+        std::snprintf(address, sizeof(address), "0x%04x", entry.address);
+        out << address << " " << entry.symbol << " " << entry.file << " " << (entry.global ? "g" : "l") << "\n";
+    }
+    return out.str();
+}
+
+#endif //EASM_ASSEMBLER_HPP
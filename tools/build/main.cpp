@@ -0,0 +1,174 @@
+/**
+ * Incremental, parallel build driver for easm projects.
+ *
+ * How to compile (from the project root directory):
+ * make build-tool
+ *
+ * How to run:
+ * ./ebuild -o program.bin [--map program.map] [-j <jobs>] [--cache <dir>] main.asm lib.asm ...
+ *
+ * Every source is hashed by content (together with the object format version, the
+ * register count and the instruction set). Objects for known hashes come from the cache directory (default
+ * .ebuild-cache), only the others are assembled, in parallel. The link step always
+ * runs, it is cheap. A rebuild costs the files that changed, not the whole project.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <sys/stat.h>
+
+#include "../assembler/assembler.hpp"
+
+struct Unit {
+    std::string source;
+    std::string content;
+    std::string object_path;
+    bool cached = false;
+    Object object;
+    std::string error;
+};
+
+// 64-bit FNV-1a
+uint64_t hash_bytes(uint64_t hash, const std::string& data) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+std::string cache_key(const std::string& content) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    hash = hash_bytes(hash, "easm-" + std::to_string(OBJECT_VERSION) + "-r" + std::to_string(CPU_NUM_REGISTERS) + "\n");
+    // a changed instruction set (src/isa.def) invalidates the cache as well
+    for (const auto& [name, info] : INSTRUCTIONS) {
+        hash = hash_bytes(hash, name + " " + std::to_string(info.opcode) + " " + std::to_string(info.operands) + "\n");
+    }
+    hash = hash_bytes(hash, content);
+
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+    return key;
+}
+
+std::vector<std::string> split_lines(const std::string& content) {
+    std::vector<std::string> lines;
+    std::istringstream in(content);
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+// Assembles one unit and stores its object in the cache
+void build_unit(Unit& unit) {
+    try {
+        unit.object = assemble(split_lines(unit.content));
+    } catch (const std::exception& e) {
+        unit.error = std::string("Assembly Error ") + e.what();
+        return;
+    }
+
+    // write next to the final name and rename, concurrent builds never see half an object
+    std::string temporary = unit.object_path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    try {
+        write_file(temporary, serialize_object(unit.object));
+        if (std::rename(temporary.c_str(), unit.object_path.c_str()) != 0) {
+            std::remove(temporary.c_str());
+        }
+    } catch (const std::exception& e) {
+        // an unwritable cache only costs the next build
+        std::cerr << "Warning: " << e.what() << "\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string output_filename;
+    std::string map_filename;
+    std::string cache_dir = ".ebuild-cache";
+    unsigned jobs = std::thread::hardware_concurrency();
+    std::vector<std::string> sources;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            output_filename = argv[++i];
+        } else if (arg == "--map" && i + 1 < argc) {
+            map_filename = argv[++i];
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cache_dir = argv[++i];
+        } else if (arg == "-j" && i + 1 < argc) {
+            jobs = (unsigned)std::stoul(argv[++i]);
+        } else {
+            sources.push_back(arg);
+        }
+    }
+    if (output_filename.empty() || sources.empty()) {
+        std::cerr << "Usage: " << argv[0] << " -o <output.bin> [--map <file>] [-j <jobs>] [--cache <dir>] <input.asm> ...\n";
+        return 1;
+    }
+    if (jobs == 0) jobs = 1;
+
+    auto start = std::chrono::steady_clock::now();
+    mkdir(cache_dir.c_str(), 0755);
+
+    try {
+        // --- 1. Hash the sources and look them up in the cache ---
+        std::vector<Unit> units(sources.size());
+        std::vector<size_t> stale;
+        for (size_t i = 0; i < sources.size(); i++) {
+            Unit& unit = units[i];
+            unit.source = sources[i];
+            unit.content = read_file(unit.source);
+            unit.object_path = cache_dir + "/" + cache_key(unit.content) + ".o";
+
+            try {
+                unit.object = deserialize_object(read_file(unit.object_path));
+                unit.cached = true;
+            } catch (const std::exception&) {
+                stale.push_back(i);
+            }
+        }
+
+        // --- 2. Assemble what is not cached, in parallel ---
+        std::atomic<size_t> next{0};
+        std::vector<std::thread> workers;
+        for (unsigned j = 0; j < jobs && j < stale.size(); j++) {
+            workers.emplace_back([&]() {
+                for (size_t k; (k = next.fetch_add(1)) < stale.size(); ) {
+                    build_unit(units[stale[k]]);
+                }
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+
+        bool failed = false;
+        for (const Unit& unit : units) {
+            if (unit.error.empty()) continue;
+            std::cerr << unit.source << ": " << unit.error << "\n";
+            failed = true;
+        }
+        if (failed) return 1;
+
+        // --- 3. Link ---
+        std::vector<LinkInput> objects;
+        for (const Unit& unit : units) objects.push_back({unit.source, unit.object});
+
+        std::vector<MapEntry> map;
+        std::vector<uint8_t> image = link(objects, &map);
+        write_file(output_filename, std::string(image.begin(), image.end()));
+        if (!map_filename.empty()) write_file(map_filename, format_map(map));
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << sources.size() << " sources: " << stale.size() << " assembled, "
+                  << sources.size() - stale.size() << " cached, " << image.size() << " bytes to "
+                  << output_filename << " in " << ms << " ms\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
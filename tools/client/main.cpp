@@ -0,0 +1,202 @@
+/**
+ * Client for the emulator daemon (./EmulatorRelease --daemon <socket>), measures job latency.
+ *
+ * How to compile (from the project root directory):
+ * make client
+ *
+ * How to run:
+ * ./eclient <socket> <program.bin> [--jobs <n>] [--pipeline <n>] [--input <text>] [--budget <n>]
+ *
+ * Registers the program, runs it <n> times with up to --pipeline requests in flight
+ * and prints the result of the first job plus latency percentiles and throughput.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../../src/daemon_protocol.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Response {
+    DaemonHeader header;
+    std::vector<uint8_t> body;
+};
+
+class Connection {
+public:
+    explicit Connection(const std::string& path) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (fd < 0 || path.size() >= sizeof(address.sun_path)) throw std::runtime_error("Cannot create socket");
+        std::strcpy(address.sun_path, path.c_str());
+        if (connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+            throw std::runtime_error("Cannot connect to " + path);
+        }
+    }
+    ~Connection() { close(fd); }
+
+    // Queues a request, send() writes all queued requests at once
+    void queue(uint8_t type, uint32_t tag, const std::vector<uint8_t>& body) {
+        DaemonHeader header{(uint32_t)body.size(), type, 0, 0, tag};
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&header);
+        pending.insert(pending.end(), bytes, bytes + sizeof(header));
+        pending.insert(pending.end(), body.begin(), body.end());
+    }
+
+    void send() {
+        size_t sent = 0;
+        while (sent < pending.size()) {
+            ssize_t n = write(fd, pending.data() + sent, pending.size() - sent);
+            if (n <= 0) throw std::runtime_error("Connection lost while sending");
+            sent += (size_t)n;
+        }
+        pending.clear();
+    }
+
+    Response receive() {
+        Response response;
+        read_exact(&response.header, sizeof(response.header));
+        response.body.resize(response.header.length);
+        read_exact(response.body.data(), response.body.size());
+        return response;
+    }
+
+private:
+    int fd;
+    std::vector<uint8_t> pending;
+    std::vector<uint8_t> buffer;
+    size_t position = 0;
+
+    void read_exact(void* data, size_t length) {
+        uint8_t* out = static_cast<uint8_t*>(data);
+        while (length > 0) {
+            if (position == buffer.size()) {
+                buffer.resize(65536);
+                ssize_t n = read(fd, buffer.data(), buffer.size());
+                if (n <= 0) throw std::runtime_error("Connection closed by the daemon");
+                buffer.resize((size_t)n);
+                position = 0;
+            }
+            size_t take = std::min(length, buffer.size() - position);
+            std::memcpy(out, buffer.data() + position, take);
+            out += take;
+            position += take;
+            length -= take;
+        }
+    }
+};
+
+void print_result(const Response& response) {
+    if (response.header.status != DAEMON_OK) {
+        std::cout << "Job failed with status " << (int)response.header.status << "\n";
+        return;
+    }
+    DaemonResult result;
+    std::memcpy(&result, response.body.data(), sizeof(result));
+    size_t registers = result.register_count ? result.register_count : 256;
+    const uint8_t* values = response.body.data() + sizeof(result);
+
+    for (size_t i = 0; i < registers; i++) {
+        if (i < 4) std::cout << (i ? " " : "") << "ABCD"[i] << ":" << (int)values[i];
+        else std::cout << " R" << i << ":" << (int)values[i];
+    }
+    std::cout << "\nPC: 0x" << std::hex << std::setw(4) << std::setfill('0') << result.pc << std::dec
+              << ", " << result.instructions << " instructions, " << result.cycles << " cycles, "
+              << (result.halted ? "halted" : "budget exhausted") << "\n";
+    if (result.output_length) {
+        std::cout << "Output: " << std::string((const char*)values + registers, result.output_length) << "\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <socket> <program.bin> [--jobs <n>] [--pipeline <n>] "
+                  << "[--input <text>] [--budget <n>]\n";
+        return 1;
+    }
+    std::string socket_path = argv[1];
+    std::string program_file = argv[2];
+    size_t jobs = 10000;
+    size_t pipeline = 1;
+    std::string input;
+    uint64_t budget = 0;
+
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--jobs") jobs = std::stoul(argv[i + 1]);
+        else if (arg == "--pipeline") pipeline = std::max<size_t>(1, std::stoul(argv[i + 1]));
+        else if (arg == "--input") input = argv[i + 1];
+        else if (arg == "--budget") budget = std::stoull(argv[i + 1]);
+    }
+
+    try {
+        std::ifstream file(program_file, std::ios::binary);
+        if (!file) throw std::runtime_error("Cannot open " + program_file);
+        std::vector<uint8_t> program((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        Connection connection(socket_path);
+
+        // --- 1. Register the program ---
+        connection.queue(DAEMON_REGISTER, 0, program);
+        connection.send();
+        Response registered = connection.receive();
+        if (registered.header.status != DAEMON_OK) {
+            throw std::runtime_error("Program rejected with status " + std::to_string(registered.header.status));
+        }
+        DaemonRegistered id;
+        std::memcpy(&id, registered.body.data(), sizeof(id));
+
+        // --- 2. Run the jobs, `pipeline` requests in flight per batch ---
+        DaemonRun run{id.program, (uint32_t)input.size(), budget};
+        std::vector<uint8_t> body(sizeof(run) + input.size());
+        std::memcpy(body.data(), &run, sizeof(run));
+        std::memcpy(body.data() + sizeof(run), input.data(), input.size());
+
+        std::vector<double> latencies;
+        latencies.reserve(jobs);
+        Response first;
+
+        auto start = Clock::now();
+        for (size_t done = 0; done < jobs; ) {
+            size_t batch = std::min(pipeline, jobs - done);
+            for (size_t i = 0; i < batch; i++) connection.queue(DAEMON_RUN, (uint32_t)(done + i), body);
+
+            auto sent = Clock::now();
+            connection.send();
+            for (size_t i = 0; i < batch; i++) {
+                Response response = connection.receive();
+                latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent).count());
+                if (done + i == 0) first = response;
+            }
+            done += batch;
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        print_result(first);
+
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double p) { return latencies[(size_t)(p * (double)(latencies.size() - 1))]; };
+        std::cout << std::fixed << std::setprecision(2)
+                  << "Jobs: " << jobs << " in " << seconds << "s, " << (double)jobs / seconds << " jobs/s, "
+                  << seconds * 1e6 / (double)jobs << " us per job (pipeline " << pipeline << ")\n"
+                  << "Latency: p50 " << percentile(0.5) << " us, p99 " << percentile(0.99)
+                  << " us, max " << latencies.back() << " us\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,295 @@
+/**
+ * Linear-sweep disassembler for the custom 8-bit CPU.
+ *
+ * How to compile (from the project root directory):
+ * make disassembler
+ *
+ * How to run:
+ * ./edis program.bin                       address, bytes and instruction per line
+ * ./edis --asm program.bin                 source easm assembles back to the same bytes
+ * ./edis --map program.map program.bin     with label names from eld/ebuild, repeated
+ *                                          file-local names get their address appended
+ * ./edis --base 0x8000 --time code.bin     other load address, decode speed on stderr
+ *
+ * Every opcode is decoded with one lookup in a table generated from src/isa.def,
+ * output is formatted by hand into one buffer and written at once. Bytes that are
+ * no instruction easm accepts (undefined or truncated opcodes, BRK, unknown registers)
+ * are printed as DB.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "../../src/config.h"
+#include "../../src/isa.h"
+
+struct Decoder {
+    const char* name;       // nullptr: not an instruction
+    uint8_t length;
+    uint8_t operands;       // OperandKind
+    bool assembler;         // accepted by easm
+};
+
+// Opcode table, generated from src/isa.def
+std::vector<Decoder> make_decoders() {
+    std::vector<Decoder> decoders(256, Decoder{nullptr, 1, OPERANDS_NONE, false});
+#define ISA(name, opcode, operands, cycles, assembler) \
+    decoders[opcode] = Decoder{#name, ISA_LENGTH_##operands, OPERANDS_##operands, assembler != 0};
+#include "../../src/isa.def"
+#undef ISA
+    return decoders;
+}
+
+const char HEX[] = "0123456789abcdef";
+
+// Output buffer without per-character capacity checks, reserve() before every line
+struct Output {
+    std::vector<char> data;
+    size_t size = 0;
+
+    void reserve(size_t bytes) {
+        if (data.size() - size < bytes) data.resize((data.size() + bytes) * 2);
+    }
+    void put(char c) { data[size++] = c; }
+    void put(const char* s) { while (*s) data[size++] = *s++; }
+    void put(const std::string& s) {
+        std::copy(s.begin(), s.end(), data.begin() + size);
+        size += s.size();
+    }
+    void put_hex8(uint8_t value) {
+        data[size++] = HEX[value >> 4];
+        data[size++] = HEX[value & 0xF];
+    }
+    void put_hex16(uint16_t value) {
+        put_hex8((uint8_t)(value >> 8));
+        put_hex8((uint8_t)value);
+    }
+    void put_register(uint8_t reg) {
+        if (reg < 4) {
+            put("ABCD"[reg]);
+            return;
+        }
+        put('R');
+        if (reg >= 100) put((char)('0' + reg / 100));
+        if (reg >= 10) put((char)('0' + reg / 10 % 10));
+        put((char)('0' + reg % 10));
+        if (reg >= CPU_NUM_REGISTERS) put('?');
+    }
+};
+
+// Labels from a map file (see format_map in tools/assembler/assembler.hpp), first one per address
+std::vector<std::string> read_map(const std::string& filename) {
+    std::vector<std::string> labels(65536);
+    std::ifstream in(filename);
+    if (!in) throw std::runtime_error("Cannot open map file " + filename);
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string address, name;
+        if (!(fields >> address >> name)) continue;
+        unsigned long value = std::stoul(address, nullptr, 0);
+        if (value < labels.size() && labels[value].empty()) labels[value] = name;
+    }
+    return labels;
+}
+
+int main(int argc, char* argv[]) {
+    std::string input_filename;
+    std::string map_filename;
+    uint16_t base = 0x0000;
+    bool as_source = false;
+    bool timing = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--asm") {
+            as_source = true;
+        } else if (arg == "--time") {
+            timing = true;
+        } else if (arg == "--map" && i + 1 < argc) {
+            map_filename = argv[++i];
+        } else if (arg == "--base" && i + 1 < argc) {
+            base = (uint16_t)std::stoul(argv[++i], nullptr, 0);
+        } else if (input_filename.empty() && arg.compare(0, 2, "--") != 0) {
+            input_filename = arg;
+        } else {
+            input_filename.clear();
+            break;
+        }
+    }
+    if (input_filename.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--asm] [--map <file>] [--base <addr>] [--time] <program.bin>\n";
+        return 1;
+    }
+    // easm has no ORG, source always assembles to address 0
+    if (as_source && base != 0) {
+        std::cerr << "Error: --asm does not take --base, easm assembles from 0x0000\n";
+        return 1;
+    }
+
+    std::ifstream infile(input_filename, std::ios::binary);
+    if (!infile) {
+        std::cerr << "Error: Cannot open input file " << input_filename << "\n";
+        return 1;
+    }
+    std::vector<uint8_t> code((std::istreambuf_iterator<char>(infile)), std::istreambuf_iterator<char>());
+
+    std::vector<std::string> labels;
+    try {
+        if (!map_filename.empty()) labels = read_map(map_filename);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    const std::vector<Decoder> decoders = make_decoders();
+    Output out;
+    out.reserve(code.size() * 24);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t instructions = 0;
+
+    // one table lookup decides the length, a truncated instruction is shown as data,
+    // so is anything easm would not assemble back when printing source
+    auto is_instruction = [&](size_t offset) {
+        const Decoder& decoder = decoders[code[offset]];
+        if (!decoder.name || offset + decoder.length > code.size()) return false;
+        if (!as_source) return true;
+        if (!decoder.assembler) return false;
+
+        size_t registers = decoder.operands == OPERANDS_REG_REG ? 2 : decoder.operands == OPERANDS_REG ? 1 : 0;
+        for (size_t i = 1; i <= registers; i++) {
+            if (code[offset + i] >= CPU_NUM_REGISTERS) return false;
+        }
+        return true;
+    };
+
+    // source only names labels that are printed, i.e. that start an instruction or a DB
+    if (as_source && !labels.empty()) {
+        std::vector<std::string> printed(labels.size());
+        for (size_t offset = 0; offset < code.size(); ) {
+            uint16_t address = (uint16_t)(base + offset);
+            printed[address] = labels[address];
+            offset += is_instruction(offset) ? decoders[code[offset]].length : 1;
+        }
+        labels.swap(printed);
+
+        // a linked map holds the file-local labels of every object, repeats get the address
+        // appended (LOOP, LOOP_0012), operands use the same table so they follow
+        std::vector<std::string> names;
+        for (const std::string& label : labels) {
+            if (!label.empty()) names.push_back(label);
+        }
+        std::sort(names.begin(), names.end());
+        std::vector<std::string> taken;
+        for (size_t address = 0; address < labels.size(); address++) {
+            std::string& label = labels[address];
+            if (label.empty()) continue;
+            if (!std::binary_search(taken.begin(), taken.end(), label)) {
+                taken.insert(std::upper_bound(taken.begin(), taken.end(), label), label);
+                continue;
+            }
+            char suffix[8];
+            std::snprintf(suffix, sizeof(suffix), "_%04zx", address);
+            std::string unique = label + suffix;
+            while (std::binary_search(names.begin(), names.end(), unique) ||
+                   std::binary_search(taken.begin(), taken.end(), unique)) {
+                unique += '_';
+            }
+            taken.insert(std::upper_bound(taken.begin(), taken.end(), unique), unique);
+            label = unique;
+        }
+    }
+
+    for (size_t offset = 0; offset < code.size(); ) {
+        uint16_t address = (uint16_t)(base + offset);
+        const Decoder& decoder = decoders[code[offset]];
+
+        bool valid = is_instruction(offset);
+        size_t length = valid ? decoder.length : 1;
+
+        // longest line without labels is well below 64 bytes
+        out.reserve(64);
+        if (!labels.empty()) {
+            const std::string& label = labels[address];
+            if (!label.empty()) {
+                out.reserve(label.size() + 2 + 64);
+                out.put(label);
+                out.put(":\n");
+            }
+        }
+
+        if (!as_source) {
+            out.put_hex16(address);
+            out.put("  ");
+            for (size_t i = 0; i < 3; i++) {
+                if (i < length) out.put_hex8(code[offset + i]);
+                else out.put("  ");
+                out.put(' ');
+            }
+            out.put(' ');
+        }
+        out.put("    ");
+
+        if (!valid) {
+            out.put("DB 0x");
+            out.put_hex8(code[offset]);
+            out.put('\n');
+            offset += 1;
+            continue;
+        }
+
+        out.put(decoder.name);
+        const uint8_t* operand = &code[offset + 1];
+        switch (decoder.operands) {
+            case OPERANDS_NONE:
+                break;
+            case OPERANDS_IMM8:
+                out.put(" 0x");
+                out.put_hex8(operand[0]);
+                break;
+            case OPERANDS_REG:
+                out.put(' ');
+                out.put_register(operand[0]);
+                break;
+            case OPERANDS_REG_REG:
+                out.put(' ');
+                out.put_register(operand[0]);
+                out.put(", ");
+                out.put_register(operand[1]);
+                break;
+            case OPERANDS_ADDR: {
+                uint16_t target = (uint16_t)(operand[0] << 8 | operand[1]);
+                out.put(' ');
+                if (!labels.empty() && !labels[target].empty()) {
+                    out.reserve(labels[target].size() + 1);
+                    out.put(labels[target]);
+                } else {
+                    out.put("0x");
+                    out.put_hex16(target);
+                }
+                break;
+            }
+        }
+        out.put('\n');
+
+        offset += length;
+        instructions++;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fwrite(out.data.data(), 1, out.size, stdout);
+
+    if (timing) {
+        std::fprintf(stderr, "%zu bytes, %zu instructions in %.3f ms, %.1f MB/s\n",
+            code.size(), instructions, seconds * 1e3, seconds > 0 ? (double)code.size() / seconds / 1e6 : 0);
+    }
+    return 0;
+}
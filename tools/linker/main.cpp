@@ -0,0 +1,63 @@
+/**
+ * Linker for easm object files.
+ *
+ * How to compile (from the project root directory):
+ * make linker
+ *
+ * How to run:
+ * ./eld -o program.bin [--map program.map] main.o lib.o ...
+ *
+ * Objects are placed in command line order from 0x0000, where the emulator loads the
+ * image and the CPU starts, i.e. at the first object.
+ * The map file lists every symbol with its final address.
+ */
+
+#include "../assembler/assembler.hpp"
+
+int main(int argc, char* argv[]) {
+    std::string output_filename;
+    std::string map_filename;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            output_filename = argv[++i];
+        } else if (arg == "--map" && i + 1 < argc) {
+            map_filename = argv[++i];
+        } else if (arg.compare(0, 2, "--") == 0) {
+            inputs.clear();     // unknown option, print the usage
+            break;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (output_filename.empty() || inputs.empty()) {
+        std::cerr << "Usage: " << argv[0] << " -o <output.bin> [--map <file>] <input.o> ...\n";
+        return 1;
+    }
+
+    try {
+        std::vector<LinkInput> objects;
+        for (const std::string& input : inputs) {
+            try {
+                objects.push_back({input, deserialize_object(read_file(input))});
+            } catch (const std::exception& e) {
+                throw std::runtime_error(input + ": " + e.what());
+            }
+        }
+
+        std::vector<MapEntry> map;
+        std::vector<uint8_t> image = link(objects, &map);
+
+        write_file(output_filename, std::string(image.begin(), image.end()));
+        if (!map_filename.empty()) write_file(map_filename, format_map(map));
+
+        std::cout << "Linked " << objects.size() << " objects, " << image.size() << " bytes to "
+                  << output_filename << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
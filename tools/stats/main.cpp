@@ -0,0 +1,282 @@
+/**
+ * Viewer for the live statistics of running emulators (see src/stats.h).
+ *
+ * How to compile (from the project root directory):
+ * make stats
+ *
+ * How to run:
+ * ./estat                         top-like view of all running emulators
+ * ./estat <name> ...              only the given instances
+ * ./estat --once                  print the view once and exit
+ * ./estat --prometheus <file>     write Prometheus text format to <file> instead
+ * ./estat --interval <seconds>    refresh interval (default 1)
+ * ./estat --clean                 remove the segments of exited emulators
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../../src/stats_segment.h"
+
+// Mnemonics for the opcode mix, generated from src/isa.def
+std::string opcode_name(int opcode) {
+    switch (opcode) {
+#define ISA(name, value, operands, cycles, assembler) case value: return #name;
+#include "../../src/isa.def"
+#undef ISA
+    }
+
+    std::ostringstream out;
+    out << "0x" << std::hex << std::setw(2) << std::setfill('0') << opcode;
+    return out.str();
+}
+
+// Indexed by CpuStop
+const char* STOP_NAMES[STATS_STOP_REASONS] = {
+    "running", "halt", "illegal", "breakpoint", "watchpoint", "5", "6", "7"
+};
+
+struct Instance {
+    std::string name;
+    StatsSegment stats;
+    bool alive;
+};
+
+bool process_alive(uint32_t pid) {
+    return kill((pid_t)pid, 0) == 0 || errno == EPERM;
+}
+
+// Names of all segments in /dev/shm
+std::vector<std::string> find_instances() {
+    std::vector<std::string> names;
+    std::string prefix = std::string(STATS_PREFIX).substr(1);
+
+    DIR* dir = opendir("/dev/shm");
+    if (!dir) return names;
+    while (dirent* entry = readdir(dir)) {
+        std::string file = entry->d_name;
+        if (file.compare(0, prefix.size(), prefix) == 0) names.push_back(file.substr(prefix.size()));
+    }
+    closedir(dir);
+
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// Copies one segment, false if it is gone or not an emulator segment
+bool read_instance(const std::string& name, StatsSegment& stats) {
+    std::string path = STATS_PREFIX + name;
+    int fd = shm_open(path.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+
+    // the emulator sizes a new segment after creating it, reading past the end would SIGBUS
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(StatsSegment)) {
+        close(fd);
+        return false;
+    }
+
+    void* memory = mmap(nullptr, sizeof(StatsSegment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) return false;
+
+    bool ok = stats_segment_read(static_cast<const StatsSegment*>(memory), &stats, 1000) &&
+        stats.magic == STATS_MAGIC && stats.version == STATS_VERSION;
+    munmap(memory, sizeof(StatsSegment));
+    return ok;
+}
+
+std::vector<Instance> read_instances(const std::vector<std::string>& names) {
+    std::vector<Instance> instances;
+    for (const std::string& name : names) {
+        Instance instance;
+        instance.name = name;
+        if (read_instance(name, instance.stats)) {
+            instance.alive = process_alive(instance.stats.pid);
+            instances.push_back(instance);
+        }
+    }
+    return instances;
+}
+
+std::string human(double value) {
+    const char* units[] = {"", "k", "M", "G", "T"};
+    int unit = 0;
+    while (value >= 1000 && unit < 4) {
+        value /= 1000;
+        unit++;
+    }
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(unit ? 1 : 0) << value << units[unit];
+    return out.str();
+}
+
+// --- Top-like view ---
+void print_top(const std::vector<Instance>& instances) {
+    std::cout << std::left
+              << std::setw(16) << "NAME" << std::setw(8) << "PID" << std::setw(12) << "STATE"
+              << std::setw(10) << "INSTR" << std::setw(10) << "IPS" << std::setw(8) << "PC"
+              << std::setw(10) << "CYCLES" << std::setw(8) << "IN" << std::setw(8) << "OUT"
+              << "TOP OPCODES (SAMPLED)\n";
+
+    for (const Instance& instance : instances) {
+        const StatsSegment& s = instance.stats;
+
+        std::ostringstream pc;
+        pc << "0x" << std::hex << std::setw(4) << std::setfill('0') << s.pc;
+
+        // the three most sampled opcodes
+        std::vector<int> order(256);
+        for (int i = 0; i < 256; i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](int a, int b) {
+            return s.opcode_samples[a] > s.opcode_samples[b];
+        });
+        uint64_t samples = 0;
+        for (int i = 0; i < 256; i++) samples += s.opcode_samples[i];
+
+        std::ostringstream mix;
+        for (int i = 0; i < 3 && samples && s.opcode_samples[order[i]]; i++) {
+            mix << opcode_name(order[i]) << " "
+                << (int)(100.0 * (double)s.opcode_samples[order[i]] / (double)samples) << "% ";
+        }
+
+        std::cout << std::left
+                  << std::setw(16) << instance.name << std::setw(8) << s.pid
+                  << std::setw(12) << (s.halted ? STOP_NAMES[s.stop % STATS_STOP_REASONS] : instance.alive ? "running" : "exited")
+                  << std::setw(10) << human((double)s.instructions) << std::setw(10) << human(s.ips)
+                  << std::setw(8) << pc.str() << std::setw(10) << human((double)s.cycles)
+                  << std::setw(8) << s.io_in << std::setw(8) << s.io_out << mix.str() << "\n";
+    }
+}
+
+// --- Prometheus text format ---
+void metric(std::ostream& out, const std::string& name, const std::string& type, const std::string& help) {
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
+}
+
+void write_prometheus(std::ostream& out, const std::vector<Instance>& instances) {
+    metric(out, "emulator_instructions_total", "counter", "Instructions retired.");
+    for (const Instance& i : instances) {
+        out << "emulator_instructions_total{instance=\"" << i.name << "\"} " << i.stats.instructions << "\n";
+    }
+    metric(out, "emulator_instructions_per_second", "gauge", "Instructions per second since the previous update.");
+    for (const Instance& i : instances) {
+        out << "emulator_instructions_per_second{instance=\"" << i.name << "\"} " << i.stats.ips << "\n";
+    }
+    metric(out, "emulator_cycles_total", "counter", "Guest clock cycles.");
+    for (const Instance& i : instances) {
+        out << "emulator_cycles_total{instance=\"" << i.name << "\"} " << i.stats.cycles << "\n";
+    }
+    metric(out, "emulator_pc", "gauge", "Program counter at the last update.");
+    for (const Instance& i : instances) {
+        out << "emulator_pc{instance=\"" << i.name << "\"} " << i.stats.pc << "\n";
+    }
+    metric(out, "emulator_halted", "gauge", "1 if the CPU is stopped.");
+    for (const Instance& i : instances) {
+        out << "emulator_halted{instance=\"" << i.name << "\"} " << (int)i.stats.halted << "\n";
+    }
+    metric(out, "emulator_stops_total", "counter", "CPU stops by reason.");
+    for (const Instance& i : instances) {
+        for (int r = 1; r < STATS_STOP_REASONS; r++) {
+            if (!i.stats.stops[r]) continue;
+            out << "emulator_stops_total{instance=\"" << i.name << "\",reason=\"" << STOP_NAMES[r] << "\"} "
+                << i.stats.stops[r] << "\n";
+        }
+    }
+    metric(out, "emulator_io_bytes_total", "counter", "Bytes moved through IN and OUT.");
+    for (const Instance& i : instances) {
+        out << "emulator_io_bytes_total{instance=\"" << i.name << "\",direction=\"in\"} " << i.stats.io_in << "\n";
+        out << "emulator_io_bytes_total{instance=\"" << i.name << "\",direction=\"out\"} " << i.stats.io_out << "\n";
+    }
+    metric(out, "emulator_opcode_samples_total", "counter", "Sampled opcodes at the program counter.");
+    for (const Instance& i : instances) {
+        for (int op = 0; op < 256; op++) {
+            if (!i.stats.opcode_samples[op]) continue;
+            out << "emulator_opcode_samples_total{instance=\"" << i.name << "\",opcode=\"" << opcode_name(op)
+                << "\"} " << i.stats.opcode_samples[op] << "\n";
+        }
+    }
+}
+
+// Writes the file next to the target and renames it, scrapers never see half a file
+bool export_prometheus(const std::string& filename, const std::vector<Instance>& instances) {
+    std::string temporary = filename + ".tmp";
+    std::ofstream out(temporary);
+    if (!out) return false;
+
+    write_prometheus(out, instances);
+    out.close();
+    return out && std::rename(temporary.c_str(), filename.c_str()) == 0;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> names;
+    std::string prometheus_file;
+    bool once = false;
+    bool clean = false;
+    double interval = 1.0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--once") {
+            once = true;
+        } else if (arg == "--clean") {
+            clean = true;
+        } else if (arg == "--prometheus" && i + 1 < argc) {
+            prometheus_file = argv[++i];
+        } else if (arg == "--interval" && i + 1 < argc) {
+            interval = std::atof(argv[++i]);
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Usage: " << argv[0] << " [--once] [--interval <s>] [--prometheus <file>] [--clean] [name ...]\n";
+            return 1;
+        } else {
+            names.push_back(arg);
+        }
+    }
+    if (interval <= 0) interval = 1.0;
+
+    if (clean) {
+        for (const Instance& instance : read_instances(names.empty() ? find_instances() : names)) {
+            if (instance.alive) continue;
+            shm_unlink((STATS_PREFIX + instance.name).c_str());
+            std::cout << "removed " << instance.name << "\n";
+        }
+        return 0;
+    }
+
+    for (;;) {
+        std::vector<Instance> instances = read_instances(names.empty() ? find_instances() : names);
+
+        if (!prometheus_file.empty()) {
+            if (!export_prometheus(prometheus_file, instances)) {
+                std::cerr << "Error: Cannot write " << prometheus_file << "\n";
+                return 1;
+            }
+        } else {
+            if (!once) std::cout << "\033[H\033[2J";    // clear the terminal
+            print_top(instances);
+            std::cout << std::flush;
+        }
+
+        if (once) break;
+        usleep((useconds_t)(interval * 1e6));
+    }
+    return 0;
+}